@@ -0,0 +1,75 @@
+#include "CompactRBF.h"
+#include <Eigen/SparseCholesky>
+#include <algorithm>
+#include <cmath>
+#include <igl/parallel_for.h>
+#include <iostream>
+#include <utility>
+
+using namespace std;
+
+bool CompactRBF::fit(const mls::Points<double> &C, const Eigen::VectorXd &D, double h_)
+{
+    h = h_;
+    const int n = C.rows();
+    index.build(C, h);
+
+    // Lower triangle of each column, straight from the neighbour queries.
+    vector<vector<pair<int, double>>> columns(n);
+    igl::parallel_for(n, [&](int i) {
+        auto &column = columns[i];
+        index.for_each_in_radius(C.row(i), h, [&](int j, double d2) {
+            if (j >= i)
+            {
+                const double phi = mls::wendland(sqrt(d2), h);
+                if (phi > 0)
+                    column.emplace_back(j, phi);
+            }
+        });
+        sort(column.begin(), column.end());
+    }, 1000);
+
+    // Compressed column storage without going through triplets.
+    Eigen::SparseMatrix<double> A(n, n);
+    long nnz = 0;
+    for (const auto &column : columns)
+        nnz += column.size();
+    A.resizeNonZeros(nnz);
+    int *outer = A.outerIndexPtr();
+    outer[0] = 0;
+    for (int i = 0; i < n; ++i)
+        outer[i + 1] = outer[i] + columns[i].size();
+    igl::parallel_for(n, [&](int i) {
+        int k = outer[i];
+        for (const auto &entry : columns[i])
+        {
+            A.innerIndexPtr()[k] = entry.first;
+            A.valuePtr()[k++] = entry.second;
+        }
+    }, 1000);
+    matrix_nonzeros = nnz;
+
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower> solver(A);
+    if (solver.info() != Eigen::Success)
+    {
+        cerr << "CompactRBF: factorisation of the interpolation matrix failed" << endl;
+        lambda.setZero(n);
+        return false;
+    }
+    lambda = solver.solve(D);
+    return true;
+}
+
+void CompactRBF::eval(const mls::Points<double> &X, Eigen::VectorXd &values) const
+{
+    values.resize(X.rows());
+    igl::parallel_for(X.rows(), [&](int i) {
+        double sum = 0;
+        int count = 0;
+        index.for_each_in_radius(X.row(i), h, [&](int j, double d2) {
+            sum += lambda(j) * mls::wendland(sqrt(d2), h);
+            ++count;
+        });
+        values(i) = count > 0 ? sum : mls::OutsideValue;
+    }, 1000);
+}
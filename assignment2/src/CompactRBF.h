@@ -0,0 +1,42 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <vector>
+#include "MLS.h"
+#include "SpatialGrid.h"
+
+// Exact interpolation of the constraints with compactly supported radial
+// basis functions,
+//
+//   f(x) = sum_j lambda_j phi(|x - c_j|),  phi(r) = (1 - r/h)^4 (4r/h + 1),
+//
+// with f(c_i) = d_i for every constraint. The Wendland function is positive
+// definite in 3D, so the sparse interpolation matrix is factored once with a
+// sparse Cholesky (LDLT) decomposition. Evaluating f afterwards is a sparse
+// sum over the constraints within h, without any per-point solve.
+class CompactRBF
+{
+public:
+    // Assemble and factor the interpolation system, and solve for the
+    // coefficients.
+    //
+    // Inputs:
+    //   C  #C x3 constrained points
+    //   D  #C x1 constrained values
+    //   h  support radius
+    // Returns false if the factorisation fails.
+    bool fit(const mls::Points<double> &C, const Eigen::VectorXd &D, double h);
+
+    // Evaluate the interpolant at every row of X, in parallel. Points with no
+    // constraint in their support get mls::OutsideValue.
+    void eval(const mls::Points<double> &X, Eigen::VectorXd &values) const;
+
+    // Number of non-zeros in the lower triangle of the interpolation matrix.
+    long nonzeros() const { return matrix_nonzeros; }
+
+private:
+    Eigen::VectorXd lambda;
+    SpatialGrid<double> index;
+    double h = 1;
+    long matrix_nonzeros = 0;
+};
@@ -0,0 +1,250 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <cmath>
+#include <igl/parallel_for.h>
+#include <utility>
+#include <vector>
+#include "MLS.h"
+#include "SpatialGrid.h"
+
+// The MLS implicit function of a set of constraints, queried at arbitrary
+// points. Owns the constraints and their spatial index, so the function can
+// be evaluated for picking, ray casting, resampling or projection without
+// going through the grid.
+//
+// All batched queries run in parallel over the query points. Distances and
+// weights are computed in Scalar, the local normal equations in double.
+template <typename Scalar>
+class ImplicitMLS
+{
+public:
+    using Points = mls::Points<Scalar>;
+    using Values = mls::Values<Scalar>;
+    using Point = Eigen::Matrix<Scalar, 1, 3>;
+
+    // Set the constraints and build their spatial index. The arrays are taken
+    // by value, so temporaries (e.g. casts) are moved in rather than copied.
+    //
+    // Inputs:
+    //   C  #C x3 constrained points
+    //   D  #C x1 constrained values
+    //   h  Wendland radius
+    //   degree  degree of the local polynomial (0, 1 or 2)
+    void set_constraints(Points C_, Values D_, Scalar h_, int degree_)
+    {
+        C = std::move(C_);
+        D = std::move(D_);
+        h = h_;
+        degree = degree_;
+        index.build(C, h);
+    }
+
+    // Evaluate the function at every row of X. Points with too few
+    // constraints in their support get mls::OutsideValue.
+    //
+    // Outputs:
+    //   values  #X x1 function values
+    //   neighbours  if not null, #X number of constraints inside the support
+    //               of each point
+    void eval(const Points &X, Values &values, std::vector<int> *neighbours = nullptr) const
+    {
+        values.resize(X.rows());
+        if (neighbours)
+            neighbours->assign(X.rows(), 0);
+        igl::parallel_for(X.rows(), [&](int i) {
+            LocalFit local;
+            int count;
+            const bool fitted = fit(X.row(i), local, count);
+            if (neighbours)
+                (*neighbours)[i] = count;
+            values(i) = fitted ? (Scalar)local.c(0) : (Scalar)mls::OutsideValue;
+        }, 1000);
+    }
+
+    // Evaluate the function and its closed-form gradient at every row of X.
+    // The gradient is zero where the value is mls::OutsideValue.
+    //
+    // Outputs:
+    //   values  #X x1 function values
+    //   gradients  #X x3 function gradients
+    void eval_with_gradient(const Points &X, Values &values, Points &gradients) const
+    {
+        values.resize(X.rows());
+        gradients.resize(X.rows(), 3);
+        igl::parallel_for(X.rows(), [&](int i) {
+            const Point x = X.row(i);
+            Eigen::Vector3d g;
+            double value;
+            if (!value_and_gradient(x, value, g))
+            {
+                values(i) = (Scalar)mls::OutsideValue;
+                gradients.row(i).setZero();
+                return;
+            }
+            values(i) = (Scalar)value;
+            gradients.row(i) = g.cast<Scalar>().transpose();
+        }, 1000);
+    }
+
+    // Move every row of X onto the zero level set with Newton steps along
+    // the gradient, x <- x - f(x) grad f(x) / |grad f(x)|^2. Points outside
+    // the support of the constraints are left unchanged.
+    void project(Points &X, int iterations = 5) const
+    {
+        igl::parallel_for(X.rows(), [&](int i) {
+            Point x = X.row(i);
+            for (int it = 0; it < iterations; ++it)
+            {
+                Eigen::Vector3d g;
+                double value;
+                if (!value_and_gradient(x, value, g) || g.squaredNorm() == 0)
+                    break;
+                x -= (value / g.squaredNorm() * g).cast<Scalar>().transpose();
+            }
+            X.row(i) = x;
+        }, 1000);
+    }
+
+    // Choose between the batched kernel (default), which gathers the
+    // neighbours of a point into compacted lists and assembles the normal
+    // equations with one matrix product, and the scalar per-neighbour path.
+    void set_batched(bool batched_) { batched = batched_; }
+
+    Scalar radius() const { return h; }
+    int polynomial_degree() const { return degree; }
+    const Points &constrained_points() const { return C; }
+    const Values &constrained_values() const { return D; }
+
+private:
+    using Matrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 10, 10>;
+    using Vector = Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 10, 1>;
+
+    // Local weighted least squares fit at a point. Fixed maximum sizes keep
+    // it off the heap.
+    struct LocalFit
+    {
+        Matrix AtA;
+        Vector c;
+        Eigen::LDLT<Matrix> ldlt;
+    };
+
+    // Fit the local polynomial at x. The basis is centred at x and scaled
+    // by 1/h, so f(x) is the constant coefficient c(0). Sets count to the
+    // number of constraints in the support, and returns false if there are
+    // too few of them for the fit.
+    bool fit(const Point &x, LocalFit &local, int &count) const
+    {
+        if (batched)
+            return fit_batched(x, local, count);
+        const int k = mls::basis_size(degree);
+        local.AtA.setZero(k, k);
+        Vector Atd = Vector::Zero(k);
+        mls::Basis b;
+        count = 0;
+        index.for_each_in_radius(x, h, [&](int j, Scalar d2) {
+            const Scalar w = mls::wendland<Scalar>(std::sqrt(d2), h);
+            if (w <= 0)
+                return;
+            mls::basis(degree, (C(j, 0) - x[0]) / h, (C(j, 1) - x[1]) / h, (C(j, 2) - x[2]) / h, b);
+            local.AtA.template selfadjointView<Eigen::Lower>().rankUpdate(b, (double)w);
+            Atd += (double)w * (double)D(j) * b;
+            ++count;
+        });
+        if (count < k)
+            return false;
+        local.ldlt.compute(local.AtA);
+        local.c = local.ldlt.solve(Atd);
+        return true;
+    }
+
+    // Neighbour lists and basis matrix of fit_batched, kept per thread and
+    // only ever grown.
+    struct Scratch
+    {
+        std::vector<int> ids;
+        std::vector<Scalar> d2, w;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> B, WB;
+        Eigen::VectorXd d;
+    };
+
+    // Same as the scalar path of fit: the weights of the compacted
+    // neighbours are evaluated in one batch, and with B the #neighbours x k
+    // basis matrix and W the weights, M = B^T W B and B^T W d.
+    bool fit_batched(const Point &x, LocalFit &local, int &count) const
+    {
+        thread_local Scratch s;
+        const int k = mls::basis_size(degree);
+        count = index.gather_in_radius(x, h, s.ids, s.d2);
+        if (count < k)
+            return false;
+        if (s.w.size() < (size_t)count)
+            s.w.resize(s.d2.size());
+        mls::wendland_weights(s.d2.data(), count, h, s.w.data());
+
+        if (s.B.rows() < count)
+        {
+            s.B.resize(2 * count, 10);
+            s.WB.resize(2 * count, 10);
+            s.d.resize(2 * count);
+        }
+        auto B = s.B.topLeftCorner(count, k);
+        auto WB = s.WB.topLeftCorner(count, k);
+        mls::Basis b;
+        for (int i = 0; i < count; ++i)
+        {
+            const int j = s.ids[i];
+            mls::basis(degree, (C(j, 0) - x[0]) / h, (C(j, 1) - x[1]) / h, (C(j, 2) - x[2]) / h, b);
+            B.row(i) = b.transpose();
+            WB.row(i) = (double)s.w[i] * b.transpose();
+            s.d(i) = D(j);
+        }
+        local.AtA.noalias() = B.transpose() * WB;
+        local.ldlt.compute(local.AtA);
+        local.c = local.ldlt.solve(WB.transpose() * s.d.head(count));
+        return true;
+    }
+
+    // Value and gradient at x. With the basis centred at x, the gradient is
+    //   grad f = grad b(0)^T c + e_0^T M^-1 sum_i grad w_i b_i (d_i - b_i^T c)
+    // where M is the weighted normal matrix and b_i the basis at constraint i.
+    bool value_and_gradient(const Point &x, double &value, Eigen::Vector3d &g) const
+    {
+        LocalFit local;
+        int count;
+        if (!fit(x, local, count))
+            return false;
+        value = local.c(0);
+
+        const int k = mls::basis_size(degree);
+        Vector dc[3] = {Vector::Zero(k), Vector::Zero(k), Vector::Zero(k)};
+        mls::Basis b;
+        const double h2 = (double)h * h;
+        index.for_each_in_radius(x, h, [&](int j, Scalar d2) {
+            const double r = std::sqrt((double)d2) / h;
+            if (r >= 1)
+                return;
+            mls::basis(degree, (C(j, 0) - x[0]) / h, (C(j, 1) - x[1]) / h, (C(j, 2) - x[2]) / h, b);
+            const double residual = (double)D(j) - b.dot(local.c);
+            // d/dx of (1 - r/h)^4 (4r/h + 1) is -20/h^2 (1 - r/h)^3 (x - p).
+            const double t = 1 - r;
+            const double dw = -20 / h2 * t * t * t * residual;
+            for (int a = 0; a < 3; ++a)
+                dc[a] += dw * ((double)x[a] - (double)C(j, a)) * b;
+        });
+        for (int a = 0; a < 3; ++a)
+        {
+            g[a] = local.ldlt.solve(dc[a])(0);
+            if (degree >= 1)
+                g[a] += local.c(1 + a) / h;
+        }
+        return true;
+    }
+
+    Points C;
+    Values D;
+    Scalar h = 1;
+    int degree = 0;
+    bool batched = true;
+    SpatialGrid<Scalar> index;
+};
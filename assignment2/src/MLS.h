@@ -0,0 +1,115 @@
+#pragma once
+#include <Eigen/Core>
+#include <cmath>
+#include <igl/parallel_for.h>
+#include "SpatialGrid.h"
+
+// Moving least squares reconstruction of an implicit function from points
+// with normals, templated on the scalar type of the point, grid and value
+// arrays. The function itself is evaluated by ImplicitMLS.
+namespace mls
+{
+template <typename Scalar>
+using Points = Eigen::Matrix<Scalar, Eigen::Dynamic, 3>;
+template <typename Scalar>
+using Values = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+// Value assigned to points with too few constraints in their support.
+// Positive, i.e. these points are treated as outside.
+const double OutsideValue = 1e5;
+
+// Number of polynomial basis functions of the given degree (0, 1 or 2).
+inline int basis_size(int degree)
+{
+    return degree <= 0 ? 1 : (degree == 1 ? 4 : 10);
+}
+
+// Wendland weight (1 - r/h)^4 (4r/h + 1) for r < h, 0 otherwise.
+template <typename Scalar>
+inline Scalar wendland(Scalar r, Scalar h)
+{
+    if (r >= h)
+        return 0;
+    const Scalar t = 1 - r / h;
+    return t * t * t * t * (4 * r / h + 1);
+}
+
+// Wendland weights of n squared distances d2 < h^2, as produced by
+// SpatialGrid::gather_in_radius, evaluated as one vectorised expression.
+template <typename Scalar>
+inline void wendland_weights(const Scalar *d2, int n, Scalar h, Scalar *w)
+{
+    using Array = Eigen::Array<Scalar, Eigen::Dynamic, 1>;
+    Eigen::Map<Array> r(w, n);
+    r = Eigen::Map<const Array>(d2, n).sqrt() / h;
+    r = (1 - r).square().square() * (4 * r + 1);
+}
+
+// Polynomial basis up to the given degree, evaluated at the offset d.
+using Basis = Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 10, 1>;
+inline void basis(int degree, double x, double y, double z, Basis &b)
+{
+    b.resize(basis_size(degree));
+    b[0] = 1;
+    if (degree >= 1)
+        b.segment<3>(1) << x, y, z;
+    if (degree >= 2)
+        b.tail<6>() << x * x, y * y, z * z, x * y, y * z, x * z;
+}
+
+// Axis-aligned bounding box diagonal of a point set.
+template <typename Scalar>
+Scalar bounding_box_diagonal(const Points<Scalar> &P)
+{
+    return (P.colwise().maxCoeff() - P.colwise().minCoeff()).norm();
+}
+
+// Build the constraints p, p + eps n and p - eps n for every input point,
+// with values 0, +eps and -eps. For every point, eps starts at eps0 and is
+// halved until p is the closest input point to p +/- eps n.
+//
+// Inputs:
+//   P  #P x3 input points
+//   N  #P x3 input normals
+//   index  spatial index over P
+//   eps0  initial offset
+// Outputs:
+//   C  3#P x3 constrained points, ordered [P; P + eps N; P - eps N]
+//   D  3#P x1 constrained values
+template <typename Scalar>
+void build_constraints(const Points<Scalar> &P, const Points<Scalar> &N, const SpatialGrid<Scalar> &index,
+                       Scalar eps0, Points<Scalar> &C, Values<Scalar> &D)
+{
+    const int n = P.rows();
+    C.resize(3 * n, 3);
+    D.resize(3 * n);
+    igl::parallel_for(n, [&](int i) {
+        const Eigen::Matrix<Scalar, 1, 3> p = P.row(i);
+        const Eigen::Matrix<Scalar, 1, 3> normal = N.row(i).normalized();
+        C.row(i) = p;
+        D(i) = 0;
+        for (int side = 1; side <= 2; ++side)
+        {
+            const Scalar sign = side == 1 ? 1 : -1;
+            Scalar eps = eps0;
+            Eigen::Matrix<Scalar, 1, 3> q;
+            for (;;)
+            {
+                q = p + sign * eps * normal;
+                // p is at distance eps from q, any other point strictly
+                // closer means the offset crosses the surface.
+                bool closer = false;
+                index.for_each_in_radius(q, eps, [&](int j, Scalar d2) {
+                    if (j != i && d2 < eps * eps * Scalar(0.999))
+                        closer = true;
+                });
+                if (!closer)
+                    break;
+                eps /= 2;
+            }
+            C.row(side * n + i) = q;
+            D(side * n + i) = sign * eps;
+        }
+    }, 1000);
+}
+} // namespace mls
@@ -0,0 +1,361 @@
+#include "OctreeContouring.h"
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <igl/PI.h>
+#include <igl/parallel_for.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+// Cell of the octree. Coordinates are integers at the finest level, i.e. a
+// cell at level l spans 2^(max_depth - l) units along each axis.
+struct Cell
+{
+    int level;
+    int x, y, z;
+    // Index of the first of the 8 children, -1 for leaves. Child i has
+    // offset (i & 1, (i >> 1) & 1, (i >> 2) & 1).
+    int first_child = -1;
+};
+
+// Minimal edge with a sign change, and the four leaves around it.
+struct SignChangeEdge
+{
+    Eigen::RowVector3d crossing;
+    int leaves[4];
+    // True if the edge goes from outside to inside, i.e. the polygon must be
+    // flipped.
+    bool flip;
+};
+
+class OctreeContourer
+{
+public:
+    OctreeContourer(const ImplicitMLS<double> &f, const Eigen::RowVector3d &bb_min, const Eigen::RowVector3d &bb_max,
+                    const OctreeContouringOptions &options)
+        : f(f), bb_min(bb_min), options(options)
+    {
+        depth = max(0, min(options.max_depth, 16));
+        resolution = 1 << depth;
+        unit = (bb_max - bb_min) / resolution;
+        cos_threshold = cos(options.normal_angle * igl::PI / 180);
+    }
+
+    void refine()
+    {
+        cells.clear();
+        cells.push_back({0, 0, 0, 0});
+        vector<int> frontier = {0};
+        for (int level = 0; !frontier.empty(); ++level)
+        {
+            sample_corners(frontier);
+            // Decide in parallel, then append the children serially.
+            vector<char> split(frontier.size(), 0);
+            if (level < depth)
+                igl::parallel_for(frontier.size(), [&](size_t i) { split[i] = needs_split(cells[frontier[i]]); }, 256);
+            vector<int> next;
+            for (size_t i = 0; i < frontier.size(); ++i)
+            {
+                if (!split[i])
+                    continue;
+                const Cell parent = cells[frontier[i]];
+                const int half = size(parent.level) / 2;
+                cells[frontier[i]].first_child = cells.size();
+                for (int c = 0; c < 8; ++c)
+                {
+                    next.push_back(cells.size());
+                    cells.push_back({parent.level + 1, parent.x + (c & 1) * half, parent.y + ((c >> 1) & 1) * half,
+                                     parent.z + ((c >> 2) & 1) * half});
+                }
+            }
+            frontier.swap(next);
+        }
+    }
+
+    int contour(Eigen::MatrixXd &V, Eigen::MatrixXi &F)
+    {
+        vector<SignChangeEdge> edges;
+        unordered_set<uint64_t> visited;
+        int leaves = 0;
+        for (size_t id = 0; id < cells.size(); ++id)
+        {
+            const Cell &cell = cells[id];
+            if (cell.first_child >= 0)
+                continue;
+            ++leaves;
+            const int s = size(cell.level);
+            for (int a = 0; a < 3; ++a)
+                for (int e = 0; e < 4; ++e)
+                {
+                    int start[3] = {cell.x, cell.y, cell.z};
+                    start[(a + 1) % 3] += (e & 1) * s;
+                    start[(a + 2) % 3] += (e >> 1) * s;
+                    add_edge(cell, a, start, visited, edges);
+                }
+        }
+
+        // Normals at the edge crossings.
+        Eigen::Matrix<double, Eigen::Dynamic, 3> crossings(edges.size(), 3), normals;
+        Eigen::VectorXd values;
+        for (size_t e = 0; e < edges.size(); ++e)
+            crossings.row(e) = edges[e].crossing;
+        f.eval_with_gradient(crossings, values, normals);
+        normals.rowwise().normalize();
+
+        // Quadratic error function of every leaf touching a sign change.
+        vector<int> leaf_vertex(cells.size(), -1);
+        vector<Eigen::Matrix3d> AtA;
+        vector<Eigen::Vector3d> Atb, mass;
+        vector<int> count, vertex_leaf;
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            const Eigen::Vector3d p = edges[e].crossing.transpose();
+            Eigen::Vector3d n = normals.row(e).transpose();
+            if (!n.allFinite())
+                n.setZero();
+            for (int leaf : edges[e].leaves)
+            {
+                int &v = leaf_vertex[leaf];
+                if (v < 0)
+                {
+                    v = vertex_leaf.size();
+                    vertex_leaf.push_back(leaf);
+                    AtA.push_back(Eigen::Matrix3d::Zero());
+                    Atb.push_back(Eigen::Vector3d::Zero());
+                    mass.push_back(Eigen::Vector3d::Zero());
+                    count.push_back(0);
+                }
+                AtA[v] += n * n.transpose();
+                Atb[v] += n * n.dot(p);
+                mass[v] += p;
+                ++count[v];
+            }
+        }
+
+        V.resize(vertex_leaf.size(), 3);
+        igl::parallel_for(vertex_leaf.size(), [&](size_t v) {
+            V.row(v) = solve_qef(cells[vertex_leaf[v]], AtA[v], Atb[v], mass[v] / count[v]).transpose();
+        }, 256);
+
+        // One polygon per minimal edge, split into triangles.
+        vector<Eigen::RowVector3i> triangles;
+        triangles.reserve(2 * edges.size());
+        for (const SignChangeEdge &edge : edges)
+        {
+            int polygon[4], n = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                const int v = leaf_vertex[edge.leaves[k]];
+                if (n == 0 || (polygon[n - 1] != v && (k < 3 || polygon[0] != v)))
+                    polygon[n++] = v;
+            }
+            if (edge.flip)
+                reverse(polygon, polygon + n);
+            if (n == 3)
+                triangles.emplace_back(polygon[0], polygon[1], polygon[2]);
+            else if (n == 4)
+            {
+                // Split along the shorter diagonal.
+                if ((V.row(polygon[0]) - V.row(polygon[2])).squaredNorm() <=
+                    (V.row(polygon[1]) - V.row(polygon[3])).squaredNorm())
+                {
+                    triangles.emplace_back(polygon[0], polygon[1], polygon[2]);
+                    triangles.emplace_back(polygon[0], polygon[2], polygon[3]);
+                }
+                else
+                {
+                    triangles.emplace_back(polygon[0], polygon[1], polygon[3]);
+                    triangles.emplace_back(polygon[1], polygon[2], polygon[3]);
+                }
+            }
+        }
+        F.resize(triangles.size(), 3);
+        for (size_t t = 0; t < triangles.size(); ++t)
+            F.row(t) = triangles[t];
+        return leaves;
+    }
+
+private:
+    int size(int level) const { return 1 << (depth - level); }
+
+    uint64_t corner_key(int x, int y, int z) const
+    {
+        const uint64_t n = resolution + 1;
+        return (uint64_t)x + n * ((uint64_t)y + n * (uint64_t)z);
+    }
+
+    Eigen::RowVector3d position(double x, double y, double z) const
+    {
+        return bb_min + Eigen::RowVector3d(x, y, z).cwiseProduct(unit);
+    }
+
+    int corner(const Cell &cell, int c) const
+    {
+        const int s = size(cell.level);
+        return corner_id.at(corner_key(cell.x + (c & 1) * s, cell.y + ((c >> 1) & 1) * s, cell.z + ((c >> 2) & 1) * s));
+    }
+
+    // Evaluate the function at the corners of the given cells that have not
+    // been sampled yet, in one batch.
+    void sample_corners(const vector<int> &ids)
+    {
+        vector<Eigen::Vector3i> added;
+        for (int id : ids)
+        {
+            const Cell &cell = cells[id];
+            const int s = size(cell.level);
+            for (int c = 0; c < 8; ++c)
+            {
+                Eigen::Vector3i p(cell.x + (c & 1) * s, cell.y + ((c >> 1) & 1) * s, cell.z + ((c >> 2) & 1) * s);
+                if (corner_id.emplace(corner_key(p[0], p[1], p[2]), corner_value.size() + added.size()).second)
+                    added.push_back(p);
+            }
+        }
+        Eigen::Matrix<double, Eigen::Dynamic, 3> X(added.size(), 3), G;
+        Eigen::VectorXd values;
+        for (size_t i = 0; i < added.size(); ++i)
+            X.row(i) = position(added[i][0], added[i][1], added[i][2]);
+        f.eval_with_gradient(X, values, G);
+        for (size_t i = 0; i < added.size(); ++i)
+        {
+            corner_value.push_back(values(i));
+            const double norm = G.row(i).norm();
+            corner_normal.push_back(norm > 0 ? Eigen::Vector3d(G.row(i).transpose() / norm)
+                                             : Eigen::Vector3d::Zero());
+        }
+    }
+
+    bool needs_split(const Cell &cell) const
+    {
+        if (cell.level < options.min_depth)
+            return true;
+        int inside = 0;
+        double closest = numeric_limits<double>::max();
+        for (int c = 0; c < 8; ++c)
+        {
+            const double v = corner_value[corner(cell, c)];
+            inside += v < 0;
+            closest = min(closest, fabs(v));
+        }
+        // Only cells crossing the surface, or close enough to contain a
+        // small feature between their corners, are refined.
+        const double half_diagonal = 0.5 * size(cell.level) * unit.norm();
+        if ((inside == 0 || inside == 8) && closest > half_diagonal)
+            return false;
+        // Refine while the normals vary too much across the cell.
+        for (int a = 0; a < 8; ++a)
+            for (int b = a + 1; b < 8; ++b)
+            {
+                const Eigen::Vector3d &na = corner_normal[corner(cell, a)], &nb = corner_normal[corner(cell, b)];
+                if (na.squaredNorm() > 0 && nb.squaredNorm() > 0 && na.dot(nb) < cos_threshold)
+                    return true;
+            }
+        return false;
+    }
+
+    // Leaf containing the point p, in half units of the finest level. -1 if
+    // p is outside the box.
+    int locate(const int p[3]) const
+    {
+        for (int d = 0; d < 3; ++d)
+            if (p[d] < 0 || p[d] > 2 * resolution)
+                return -1;
+        int id = 0;
+        while (cells[id].first_child >= 0)
+        {
+            const Cell &cell = cells[id];
+            const int half = size(cell.level) / 2;
+            const int child = (p[0] >= 2 * (cell.x + half)) + 2 * (p[1] >= 2 * (cell.y + half)) +
+                              4 * (p[2] >= 2 * (cell.z + half));
+            id = cell.first_child + child;
+        }
+        return id;
+    }
+
+    // Record the edge of the leaf starting at start along axis a, if it has a
+    // sign change and is minimal, i.e. no leaf around it is smaller.
+    void add_edge(const Cell &cell, int a, const int start[3], unordered_set<uint64_t> &visited,
+                  vector<SignChangeEdge> &edges) const
+    {
+        const int s = size(cell.level);
+        int end[3] = {start[0], start[1], start[2]};
+        end[a] += s;
+        const double v0 = corner_value[corner_id.at(corner_key(start[0], start[1], start[2]))];
+        const double v1 = corner_value[corner_id.at(corner_key(end[0], end[1], end[2]))];
+        if ((v0 < 0) == (v1 < 0))
+            return;
+
+        const int b = (a + 1) % 3, c = (a + 2) % 3;
+        SignChangeEdge edge;
+        // Leaves around the edge, counter-clockwise seen from +a.
+        static const int offsets[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+        for (int k = 0; k < 4; ++k)
+        {
+            int p[3];
+            p[a] = 2 * start[a] + s;
+            p[b] = 2 * start[b] + offsets[k][0];
+            p[c] = 2 * start[c] + offsets[k][1];
+            const int leaf = locate(p);
+            // Surface leaving the box, or a smaller leaf owns part of the edge.
+            if (leaf < 0 || cells[leaf].level > cell.level)
+                return;
+            edge.leaves[k] = leaf;
+        }
+
+        const uint64_t key = ((corner_key(start[0], start[1], start[2]) * 3 + a) << 5) | cell.level;
+        if (!visited.insert(key).second)
+            return;
+
+        const double t = v0 / (v0 - v1);
+        edge.crossing = (1 - t) * position(start[0], start[1], start[2]) + t * position(end[0], end[1], end[2]);
+        edge.flip = v0 >= 0;
+        edges.push_back(edge);
+    }
+
+    // Minimise the quadratic error function around the mass point, ignoring
+    // poorly determined directions, and keep the result inside the cell.
+    Eigen::Vector3d solve_qef(const Cell &cell, const Eigen::Matrix3d &AtA, const Eigen::Vector3d &Atb,
+                              const Eigen::Vector3d &mass_point) const
+    {
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen(AtA);
+        const Eigen::Vector3d lambda = eigen.eigenvalues();
+        const double cutoff = 0.1 * lambda.maxCoeff();
+        Eigen::Vector3d inverse = Eigen::Vector3d::Zero();
+        for (int d = 0; d < 3; ++d)
+            if (lambda[d] > cutoff && lambda[d] > 0)
+                inverse[d] = 1 / lambda[d];
+        const Eigen::Matrix3d U = eigen.eigenvectors();
+        Eigen::Vector3d x = mass_point + U * inverse.asDiagonal() * U.transpose() * (Atb - AtA * mass_point);
+
+        const int s = size(cell.level);
+        const Eigen::Vector3d lo = position(cell.x, cell.y, cell.z).transpose();
+        const Eigen::Vector3d hi = position(cell.x + s, cell.y + s, cell.z + s).transpose();
+        return x.cwiseMax(lo).cwiseMin(hi);
+    }
+
+    const ImplicitMLS<double> &f;
+    Eigen::RowVector3d bb_min, unit;
+    OctreeContouringOptions options;
+    int depth, resolution;
+    double cos_threshold;
+
+    vector<Cell> cells;
+    unordered_map<uint64_t, int> corner_id;
+    vector<double> corner_value;
+    vector<Eigen::Vector3d> corner_normal;
+};
+} // namespace
+
+int octree_contour(const ImplicitMLS<double> &f, const Eigen::RowVector3d &bb_min, const Eigen::RowVector3d &bb_max,
+                   const OctreeContouringOptions &options, Eigen::MatrixXd &V, Eigen::MatrixXi &F)
+{
+    OctreeContourer contourer(f, bb_min, bb_max, options);
+    contourer.refine();
+    return contourer.contour(V, F);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <Eigen/Core>
+#include "ImplicitMLS.h"
+
+// Options for octree_contour.
+struct OctreeContouringOptions
+{
+    // Depth down to which the whole box is subdivided uniformly.
+    int min_depth = 3;
+    // Maximum depth of the octree (at most 16). A uniform grid with the same
+    // finest spacing has 2^max_depth + 1 samples per axis.
+    int max_depth = 7;
+    // Cells crossing the surface are subdivided while the angle between the
+    // gradients at their corners exceeds this value, in degrees.
+    double normal_angle = 20;
+};
+
+// Adaptive dual contouring of the zero level set of an implicit function.
+//
+// Starting from the bounding box, cells are refined only where the function
+// changes sign or comes close to zero, and only as long as the normals
+// (gradients) inside the cell vary by more than options.normal_angle. Flat
+// regions therefore end up in large cells. Every leaf around a minimal edge
+// with a sign change gets one vertex, placed by minimising the quadratic
+// error function of the edge intersections and normals; the polygons
+// connect the leaves around each minimal edge, which makes the output
+// crack-free across cells of different sizes.
+//
+// Inputs:
+//   f  implicit function, negative inside
+//   bb_min, bb_max  box to contour
+//   options  refinement options
+// Outputs:
+//   V  #V x3 vertex positions
+//   F  #F x3 triangles
+// Returns the number of octree leaves.
+int octree_contour(const ImplicitMLS<double> &f, const Eigen::RowVector3d &bb_min, const Eigen::RowVector3d &bb_max,
+                   const OctreeContouringOptions &options, Eigen::MatrixXd &V, Eigen::MatrixXi &F);
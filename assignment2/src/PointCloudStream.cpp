@@ -0,0 +1,408 @@
+#include "PointCloudStream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+// Receives count points as consecutive x y z nx ny nz values.
+using ChunkCallback = function<void(const double *xyzn, int count)>;
+
+// Receives the number of points announced by the file header, if any.
+using CountCallback = function<void(long count)>;
+
+bool has_extension(const string &filename, const string &ext)
+{
+    if (filename.size() < ext.size())
+        return false;
+    string tail = filename.substr(filename.size() - ext.size());
+    transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+    return tail == ext;
+}
+
+// PLY scalar property types.
+enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_UNKNOWN };
+
+PlyType ply_type(const string &name)
+{
+    if (name == "char" || name == "int8") return PLY_INT8;
+    if (name == "uchar" || name == "uint8") return PLY_UINT8;
+    if (name == "short" || name == "int16") return PLY_INT16;
+    if (name == "ushort" || name == "uint16") return PLY_UINT16;
+    if (name == "int" || name == "int32") return PLY_INT32;
+    if (name == "uint" || name == "uint32") return PLY_UINT32;
+    if (name == "float" || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_UNKNOWN;
+}
+
+int ply_size(PlyType type)
+{
+    static const int sizes[] = {1, 1, 2, 2, 4, 4, 4, 8, 0};
+    return sizes[type];
+}
+
+template <typename T>
+double decode(const char *bytes, bool swap)
+{
+    char buffer[sizeof(T)];
+    memcpy(buffer, bytes, sizeof(T));
+    if (swap)
+        reverse(buffer, buffer + sizeof(T));
+    T value;
+    memcpy(&value, buffer, sizeof(T));
+    return (double)value;
+}
+
+double decode(const char *bytes, PlyType type, bool swap)
+{
+    switch (type)
+    {
+    case PLY_INT8: return decode<int8_t>(bytes, swap);
+    case PLY_UINT8: return decode<uint8_t>(bytes, swap);
+    case PLY_INT16: return decode<int16_t>(bytes, swap);
+    case PLY_UINT16: return decode<uint16_t>(bytes, swap);
+    case PLY_INT32: return decode<int32_t>(bytes, swap);
+    case PLY_UINT32: return decode<uint32_t>(bytes, swap);
+    case PLY_FLOAT32: return decode<float>(bytes, swap);
+    case PLY_FLOAT64: return decode<double>(bytes, swap);
+    default: return 0;
+    }
+}
+
+struct PlyElement
+{
+    string name;
+    long count = 0;
+    vector<string> property_names;
+    vector<PlyType> property_types;
+    bool has_list = false;
+};
+
+bool read_ply(const string &filename, int chunk_size, const CountCallback &announce, const ChunkCallback &consume)
+{
+    ifstream in(filename, ios::binary);
+    if (!in)
+    {
+        cerr << "Could not open " << filename << endl;
+        return false;
+    }
+
+    // Header
+    string line, format;
+    vector<PlyElement> elements;
+    getline(in, line);
+    if (line.compare(0, 3, "ply") != 0)
+    {
+        cerr << filename << " is not a PLY file" << endl;
+        return false;
+    }
+    while (getline(in, line))
+    {
+        istringstream tokens(line);
+        string keyword;
+        tokens >> keyword;
+        if (keyword == "format")
+            tokens >> format;
+        else if (keyword == "element")
+        {
+            elements.emplace_back();
+            tokens >> elements.back().name >> elements.back().count;
+        }
+        else if (keyword == "property" && !elements.empty())
+        {
+            string type, name;
+            tokens >> type;
+            if (type == "list")
+            {
+                elements.back().has_list = true;
+                string count_type, item_type;
+                tokens >> count_type >> item_type;
+            }
+            tokens >> name;
+            elements.back().property_names.push_back(name);
+            elements.back().property_types.push_back(ply_type(type));
+        }
+        else if (keyword == "end_header")
+            break;
+    }
+
+    const bool ascii = format == "ascii";
+    const uint16_t probe = 1;
+    const bool host_little = *reinterpret_cast<const uint8_t *>(&probe) == 1;
+    bool swap = false;
+    if (format == "binary_little_endian")
+        swap = !host_little;
+    else if (format == "binary_big_endian")
+        swap = host_little;
+    else if (!ascii)
+    {
+        cerr << filename << ": unsupported PLY format '" << format << "'" << endl;
+        return false;
+    }
+
+    // Skip the elements preceding the vertices.
+    size_t e = 0;
+    for (; e < elements.size() && elements[e].name != "vertex"; ++e)
+    {
+        if (ascii)
+        {
+            for (long i = 0; i < elements[e].count; ++i)
+                getline(in, line);
+            continue;
+        }
+        if (elements[e].has_list)
+        {
+            cerr << filename << ": cannot skip element '" << elements[e].name
+                 << "' with list properties before the vertices" << endl;
+            return false;
+        }
+        long size = 0;
+        for (PlyType type : elements[e].property_types)
+            size += ply_size(type);
+        in.seekg(size * elements[e].count, ios::cur);
+    }
+    if (e == elements.size())
+    {
+        cerr << filename << ": no vertex element" << endl;
+        return false;
+    }
+    const PlyElement &vertex = elements[e];
+    if (vertex.has_list)
+    {
+        cerr << filename << ": list properties on vertices are not supported" << endl;
+        return false;
+    }
+
+    // Location of x y z nx ny nz among the vertex properties.
+    static const char *wanted[6] = {"x", "y", "z", "nx", "ny", "nz"};
+    int column[6], offset[6];
+    PlyType type[6];
+    int record_size = 0;
+    for (int k = 0; k < 6; ++k)
+        column[k] = -1;
+    for (size_t p = 0; p < vertex.property_names.size(); ++p)
+    {
+        if (vertex.property_types[p] == PLY_UNKNOWN)
+        {
+            cerr << filename << ": unknown type of vertex property '" << vertex.property_names[p] << "'" << endl;
+            return false;
+        }
+        for (int k = 0; k < 6; ++k)
+            if (vertex.property_names[p] == wanted[k])
+            {
+                column[k] = p;
+                offset[k] = record_size;
+                type[k] = vertex.property_types[p];
+            }
+        record_size += ply_size(vertex.property_types[p]);
+    }
+    for (int k = 0; k < 6; ++k)
+        if (column[k] < 0)
+        {
+            cerr << filename << ": missing vertex property '" << wanted[k] << "'" << endl;
+            return false;
+        }
+
+    // Vertices, chunk by chunk.
+    announce(vertex.count);
+    vector<double> xyzn(6 * (size_t)chunk_size);
+    vector<char> records(ascii ? 0 : (size_t)record_size * chunk_size);
+    vector<double> values(vertex.property_names.size());
+    long remaining = vertex.count;
+    while (remaining > 0)
+    {
+        const int wanted_count = (int)min<long>(remaining, chunk_size);
+        int count = 0;
+        if (ascii)
+        {
+            for (; count < wanted_count && getline(in, line); ++count)
+            {
+                istringstream tokens(line);
+                for (double &value : values)
+                    tokens >> value;
+                for (int k = 0; k < 6; ++k)
+                    xyzn[6 * count + k] = values[column[k]];
+            }
+        }
+        else
+        {
+            in.read(records.data(), (streamsize)record_size * wanted_count);
+            count = in.gcount() / record_size;
+            for (int i = 0; i < count; ++i)
+                for (int k = 0; k < 6; ++k)
+                    xyzn[6 * i + k] = decode(&records[(size_t)i * record_size + offset[k]], type[k], swap);
+        }
+        consume(xyzn.data(), count);
+        remaining -= count;
+        if (count < wanted_count)
+        {
+            cerr << filename << ": file ends after " << vertex.count - remaining << " of " << vertex.count
+                 << " vertices" << endl;
+            break;
+        }
+    }
+    return true;
+}
+
+bool read_xyzn(const string &filename, int chunk_size, const ChunkCallback &consume)
+{
+    ifstream in(filename);
+    if (!in)
+    {
+        cerr << "Could not open " << filename << endl;
+        return false;
+    }
+    vector<double> xyzn(6 * (size_t)chunk_size);
+    string line;
+    int count = 0;
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        istringstream tokens(line);
+        double *point = &xyzn[6 * count];
+        int k = 0;
+        while (k < 6 && tokens >> point[k])
+            ++k;
+        // Lines without a normal cannot be used, mark them as invalid.
+        if (k < 6)
+            point[0] = NAN;
+        if (++count == chunk_size)
+        {
+            consume(xyzn.data(), count);
+            count = 0;
+        }
+    }
+    if (count > 0)
+        consume(xyzn.data(), count);
+    return true;
+}
+
+struct VoxelKey
+{
+    int64_t x, y, z;
+    bool operator==(const VoxelKey &o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct VoxelKeyHash
+{
+    size_t operator()(const VoxelKey &k) const
+    {
+        return (size_t)(k.x * 73856093) ^ (size_t)(k.y * 19349663) ^ (size_t)(k.z * 83492791);
+    }
+};
+} // namespace
+
+bool is_streamable_point_cloud(const string &filename)
+{
+    return has_extension(filename, ".ply") || has_extension(filename, ".xyz") || has_extension(filename, ".xyzn");
+}
+
+bool stream_point_cloud(const string &filename, const PointCloudStreamOptions &options, Eigen::MatrixXd &P_out,
+                        Eigen::MatrixXd &N_out, SpatialGrid<double> *index_out)
+{
+    const bool downsample = options.voxel_size > 0;
+    const int chunk_size = max(1, options.chunk_size);
+
+    // Accepted points (or voxel sums when downsampling) are written straight
+    // into the first n rows of P and N. They grow geometrically, or are
+    // allocated once when the header announces the number of points, and are
+    // trimmed to n rows at the end. They and the index are local until the
+    // whole file has been read, so the outputs stay untouched on failure.
+    int n = 0;
+    Eigen::MatrixXd P(0, 3), N(0, 3);
+    SpatialGrid<double> grid;
+    SpatialGrid<double> *index = index_out ? &grid : nullptr;
+    auto reserve = [&](long rows) {
+        if (rows <= P.rows())
+            return;
+        P.conservativeResize(rows, 3);
+        N.conservativeResize(rows, 3);
+    };
+    vector<int> voxel_count;
+    unordered_map<VoxelKey, int, VoxelKeyHash> voxel_slot;
+    long dropped = 0;
+
+    auto announce = [&](long count) {
+        // With downsampling the count is only an upper bound.
+        if (!downsample)
+            reserve(count);
+    };
+    auto consume = [&](const double *xyzn, int count) {
+        const int first = n;
+        if (n + count > P.rows())
+            reserve(max<long>(2 * P.rows(), n + count));
+        for (int i = 0; i < count; ++i)
+        {
+            const double *p = xyzn + 6 * i, *q = p + 3;
+            bool finite = true;
+            for (int k = 0; k < 6; ++k)
+                finite = finite && std::isfinite(p[k]);
+            if (!finite || q[0] * q[0] + q[1] * q[1] + q[2] * q[2] == 0)
+            {
+                ++dropped;
+                continue;
+            }
+            if (downsample)
+            {
+                const VoxelKey key = {(int64_t)floor(p[0] / options.voxel_size),
+                                      (int64_t)floor(p[1] / options.voxel_size),
+                                      (int64_t)floor(p[2] / options.voxel_size)};
+                auto inserted = voxel_slot.emplace(key, n);
+                if (!inserted.second)
+                {
+                    const int slot = inserted.first->second;
+                    P.row(slot) += Eigen::RowVector3d(p[0], p[1], p[2]);
+                    N.row(slot) += Eigen::RowVector3d(q[0], q[1], q[2]);
+                    ++voxel_count[slot];
+                    continue;
+                }
+                voxel_count.push_back(1);
+            }
+            P.row(n) << p[0], p[1], p[2];
+            N.row(n) << q[0], q[1], q[2];
+            ++n;
+        }
+        // Voxel means are only final at the end of the file; otherwise index
+        // the chunk right away.
+        if (index && !downsample && n > first)
+            index->insert(P.middleRows(first, n - first));
+    };
+
+    bool ok = has_extension(filename, ".ply") ? read_ply(filename, chunk_size, announce, consume)
+                                              : read_xyzn(filename, chunk_size, consume);
+    if (!ok)
+        return false;
+
+    if (P.rows() != n)
+    {
+        P.conservativeResize(n, 3);
+        N.conservativeResize(n, 3);
+    }
+    if (downsample)
+    {
+        for (int i = 0; i < n; ++i)
+            P.row(i) /= voxel_count[i];
+        if (index)
+            index->insert(P);
+    }
+    N.rowwise().normalize();
+
+    if (dropped > 0)
+        cerr << filename << ": dropped " << dropped << " points with non-finite coordinates or normals" << endl;
+    P_out.swap(P);
+    N_out.swap(N);
+    if (index_out)
+        swap(*index_out, grid);
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <Eigen/Core>
+#include <string>
+#include "SpatialGrid.h"
+
+// Options for stream_point_cloud.
+struct PointCloudStreamOptions
+{
+    // Number of points read from the file at once.
+    int chunk_size = 1 << 16;
+    // Edge length of the voxels used for on-the-fly downsampling, in world
+    // units. All points falling into the same voxel are replaced by their
+    // mean position and normal. 0 disables downsampling.
+    double voxel_size = 0;
+};
+
+// Returns true if filename has an extension handled by stream_point_cloud
+// (.ply, .xyz, .xyzn).
+bool is_streamable_point_cloud(const std::string &filename);
+
+// Read a point cloud with normals in chunks, without loading the whole file.
+//
+// Supported formats are PLY (binary little/big endian and ascii) with
+// x, y, z, nx, ny, nz vertex properties of any numeric type, and XYZN text
+// files with one "x y z nx ny nz" point per line. Points with a non-finite
+// position or normal, or with a zero normal, are dropped.
+//
+// Inputs:
+//   filename  path to the point cloud
+//   options   chunking and downsampling options
+// Outputs:
+//   P  #P x3 point positions
+//   N  #P x3 unit normals
+//   index  if not null, replaced by an index of the points, filled chunk by
+//          chunk; the caller finalizes it with the cell size it needs
+// Returns false if the file cannot be read, in which case P, N and index are
+// left unchanged.
+bool stream_point_cloud(const std::string &filename, const PointCloudStreamOptions &options,
+                        Eigen::MatrixXd &P, Eigen::MatrixXd &N, SpatialGrid<double> *index = nullptr);
@@ -0,0 +1,177 @@
+#include "PolygonSoup.h"
+#include <algorithm>
+#include <cmath>
+#include <igl/parallel_for.h>
+
+constexpr double PolygonSoupImplicit::OutsideValue;
+
+namespace
+{
+// Maximum number of triangles in a BVH leaf.
+const int LEAF_SIZE = 4;
+// Maximum number of 1-to-4 subdivisions applied to a single soup triangle.
+const int MAX_SUBDIVISION = 6;
+
+// Degree-2 quadrature on a triangle: three interior points of equal weight.
+void add_quadrature(const Eigen::Vector3d &a, const Eigen::Vector3d &b,
+                    const Eigen::Vector3d &c, double max_edge, int depth,
+                    std::vector<double> &qx, std::vector<double> &qy,
+                    std::vector<double> &qz, std::vector<double> &qw)
+{
+    double longest = std::max({(b - a).norm(), (c - b).norm(), (a - c).norm()});
+    if (longest > max_edge && depth < MAX_SUBDIVISION)
+    {
+        Eigen::Vector3d ab = 0.5 * (a + b), bc = 0.5 * (b + c), ca = 0.5 * (c + a);
+        add_quadrature(a, ab, ca, max_edge, depth + 1, qx, qy, qz, qw);
+        add_quadrature(ab, b, bc, max_edge, depth + 1, qx, qy, qz, qw);
+        add_quadrature(ca, bc, c, max_edge, depth + 1, qx, qy, qz, qw);
+        add_quadrature(ab, bc, ca, max_edge, depth + 1, qx, qy, qz, qw);
+        return;
+    }
+    const double area = 0.5 * (b - a).cross(c - a).norm();
+    const Eigen::Vector3d p[3] = {(4 * a + b + c) / 6, (a + 4 * b + c) / 6, (a + b + 4 * c) / 6};
+    for (int i = 0; i < 3; ++i)
+    {
+        qx.push_back(p[i].x());
+        qy.push_back(p[i].y());
+        qz.push_back(p[i].z());
+        qw.push_back(area / 3);
+    }
+}
+} // namespace
+
+void PolygonSoupImplicit::build(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, double radius)
+{
+    h = radius;
+    const int nf = F.rows();
+    tri_normal.assign(nf, Eigen::Vector3d::Zero());
+    tri_box.assign(nf, Eigen::AlignedBox3d());
+    tri_quad_begin.assign(nf + 1, 0);
+    quad_x.clear();
+    quad_y.clear();
+    quad_z.clear();
+    quad_weight.clear();
+
+    // Half the support radius keeps the weight function well resolved by the
+    // three-point rule.
+    const double max_edge = 0.5 * radius;
+    for (int f = 0; f < nf; ++f)
+    {
+        tri_quad_begin[f] = quad_weight.size();
+        Eigen::Vector3d a = V.row(F(f, 0)), b = V.row(F(f, 1)), c = V.row(F(f, 2));
+        Eigen::Vector3d n = (b - a).cross(c - a);
+        // Degenerate triangles carry no area and get no quadrature points.
+        if (n.norm() == 0)
+            continue;
+        tri_normal[f] = n.normalized();
+        tri_box[f].extend(a).extend(b).extend(c);
+        add_quadrature(a, b, c, max_edge, 0, quad_x, quad_y, quad_z, quad_weight);
+    }
+    tri_quad_begin[nf] = quad_weight.size();
+
+    build_bvh();
+}
+
+void PolygonSoupImplicit::build_bvh()
+{
+    const int nf = tri_normal.size();
+    std::vector<Eigen::Vector3d> centroids(nf);
+    tri_order.resize(nf);
+    for (int f = 0; f < nf; ++f)
+    {
+        tri_order[f] = f;
+        centroids[f] = tri_box[f].isEmpty() ? Eigen::Vector3d::Zero().eval() : tri_box[f].center().eval();
+    }
+    nodes.clear();
+    nodes.reserve(2 * (nf / LEAF_SIZE + 1));
+    if (nf > 0)
+        build_node(0, nf, centroids);
+}
+
+int PolygonSoupImplicit::build_node(int begin, int end, std::vector<Eigen::Vector3d> &centroids)
+{
+    const int id = nodes.size();
+    nodes.emplace_back();
+
+    Eigen::AlignedBox3d box, centroid_box;
+    for (int k = begin; k < end; ++k)
+    {
+        box.extend(tri_box[tri_order[k]]);
+        centroid_box.extend(centroids[tri_order[k]]);
+    }
+    nodes[id].box = box;
+
+    if (end - begin <= LEAF_SIZE)
+    {
+        nodes[id].begin = begin;
+        nodes[id].end = end;
+        return id;
+    }
+
+    // Median split along the longest axis of the centroid bounds.
+    int axis;
+    centroid_box.sizes().maxCoeff(&axis);
+    const int mid = (begin + end) / 2;
+    std::nth_element(tri_order.begin() + begin, tri_order.begin() + mid, tri_order.begin() + end,
+                     [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    const int left = build_node(begin, mid, centroids);
+    const int right = build_node(mid, end, centroids);
+    nodes[id].left = left;
+    nodes[id].right = right;
+    return id;
+}
+
+double PolygonSoupImplicit::evaluate(const Eigen::RowVector3d &x) const
+{
+    if (nodes.empty())
+        return OutsideValue;
+
+    const Eigen::Vector3d p = x.transpose();
+    const double h2 = h * h;
+    double numerator = 0, denominator = 0;
+
+    // The median split keeps the tree balanced, so its depth stays far below
+    // the stack size.
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node &node = nodes[stack[--top]];
+        if (node.box.squaredExteriorDistance(p) >= h2)
+            continue;
+        if (node.left >= 0)
+        {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+            continue;
+        }
+        for (int k = node.begin; k < node.end; ++k)
+        {
+            const int t = tri_order[k];
+            if (tri_box[t].squaredExteriorDistance(p) >= h2)
+                continue;
+            const Eigen::Vector3d &n = tri_normal[t];
+            for (int q = tri_quad_begin[t]; q < tri_quad_begin[t + 1]; ++q)
+            {
+                const double dx = p.x() - quad_x[q], dy = p.y() - quad_y[q], dz = p.z() - quad_z[q];
+                const double r2 = dx * dx + dy * dy + dz * dz;
+                if (r2 >= h2)
+                    continue;
+                const double r = std::sqrt(r2) / h;
+                const double w = quad_weight[q] * std::pow(1 - r, 4) * (4 * r + 1);
+                numerator += w * (n.x() * dx + n.y() * dy + n.z() * dz);
+                denominator += w;
+            }
+        }
+    }
+
+    return denominator > 0 ? numerator / denominator : OutsideValue;
+}
+
+void PolygonSoupImplicit::evaluate(const Eigen::MatrixXd &X, Eigen::VectorXd &values) const
+{
+    values.resize(X.rows());
+    igl::parallel_for(X.rows(), [&](int i) { values(i) = evaluate(Eigen::RowVector3d(X.row(i))); }, 1000);
+}
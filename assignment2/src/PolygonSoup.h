@@ -0,0 +1,75 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <vector>
+
+// Approximating implicit surface from polygon soup, following
+// Chen Shen, James F. O'Brien, and Jonathan Richard Shewchuk. Interpolating
+// and approximating implicit surfaces from polygon soup.
+//
+// With constant basis functions, the value at x is the Wendland-weighted
+// average of the triangle planes, integrated over each triangle:
+//
+//   f(x) = sum_t int_t w(|x - p|) n_t.(x - p) dp / sum_t int_t w(|x - p|) dp
+//
+// The integrals use a fixed quadrature rule per triangle, precomputed in
+// build(). Triangles larger than the weight support are subdivided so that
+// their quadrature still resolves the weight function. A bounding volume
+// hierarchy over the triangles culls everything beyond the support radius.
+class PolygonSoupImplicit
+{
+public:
+    // Value returned at points where no triangle lies inside the support.
+    // Positive, i.e. these points are treated as outside.
+    static constexpr double OutsideValue = 1e5;
+
+    // Precompute the quadrature data and the BVH.
+    //
+    // Inputs:
+    //   V  #V x3 soup vertex positions
+    //   F  #F x3 soup triangles
+    //   radius  Wendland support radius the soup will be evaluated with
+    void build(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, double radius);
+
+    // Evaluate the implicit function at each row of X, in parallel.
+    //
+    // Inputs:
+    //   X  #X x3 query points
+    // Outputs:
+    //   values  #X x1 implicit function values
+    void evaluate(const Eigen::MatrixXd &X, Eigen::VectorXd &values) const;
+
+    // Evaluate the implicit function at a single point.
+    double evaluate(const Eigen::RowVector3d &x) const;
+
+    int num_triangles() const { return (int)tri_normal.size(); }
+    int num_quadrature_points() const { return (int)quad_weight.size(); }
+
+private:
+    struct Node
+    {
+        Eigen::AlignedBox3d box;
+        // Children for inner nodes, -1 for leaves.
+        int left = -1, right = -1;
+        // Range in tri_order for leaves.
+        int begin = 0, end = 0;
+    };
+
+    void build_bvh();
+    int build_node(int begin, int end, std::vector<Eigen::Vector3d> &centroids);
+
+    double h = 0;
+
+    // Per triangle: unit normal, bounding box and range in the quadrature
+    // arrays.
+    std::vector<Eigen::Vector3d> tri_normal;
+    std::vector<Eigen::AlignedBox3d> tri_box;
+    std::vector<int> tri_quad_begin;
+
+    // Quadrature points and area-scaled weights, stored contiguously per
+    // triangle (struct of arrays).
+    std::vector<double> quad_x, quad_y, quad_z, quad_weight;
+
+    std::vector<Node> nodes;
+    std::vector<int> tri_order;
+};
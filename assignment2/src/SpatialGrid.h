@@ -0,0 +1,236 @@
+#pragma once
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Uniform grid over a point set for fixed-radius neighbour queries.
+//
+// Points are bucketed by cell and stored cell by cell as separate x/y/z
+// arrays, so the points of neighbouring cells are contiguous in memory.
+// Templated on the scalar type of the coordinates.
+template <typename Scalar>
+class SpatialGrid
+{
+public:
+    using Points = Eigen::Matrix<Scalar, Eigen::Dynamic, 3>;
+    using Point = Eigen::Matrix<Scalar, 1, 3>;
+
+    // Build the grid.
+    //
+    // Inputs:
+    //   P  #P x3 point positions
+    //   cell_size  edge length of the cells, usually the query radius
+    void build(const Points &P, Scalar cell_size)
+    {
+        clear();
+        insert(P);
+        finalize(cell_size);
+    }
+
+    // Remove all points.
+    void clear()
+    {
+        bounds_min.setConstant(std::numeric_limits<Scalar>::max());
+        bounds_max.setConstant(std::numeric_limits<Scalar>::lowest());
+        cell_start.assign(1, 0);
+        ids.clear();
+        xs.clear();
+        ys.clear();
+        zs.clear();
+        finalized = true;
+    }
+
+    // Append points, e.g. one chunk of a streamed point cloud. They are
+    // numbered after the points inserted so far and become visible to
+    // queries after the next finalize(). P is any #P x3 matrix expression,
+    // so blocks of larger matrices are inserted without a copy.
+    template <typename Derived>
+    void insert(const Eigen::MatrixBase<Derived> &P)
+    {
+        const size_t offset = xs.size();
+        xs.resize(offset + P.rows());
+        ys.resize(offset + P.rows());
+        zs.resize(offset + P.rows());
+        for (int i = 0; i < P.rows(); ++i)
+        {
+            xs[offset + i] = (Scalar)P(i, 0);
+            ys[offset + i] = (Scalar)P(i, 1);
+            zs[offset + i] = (Scalar)P(i, 2);
+        }
+        if (P.rows() > 0)
+        {
+            bounds_min = bounds_min.cwiseMin(P.colwise().minCoeff().template cast<Scalar>());
+            bounds_max = bounds_max.cwiseMax(P.colwise().maxCoeff().template cast<Scalar>());
+        }
+        finalized = false;
+    }
+
+    // Bucket all inserted points into cells of the given size.
+    void finalize(Scalar cell_size)
+    {
+        const int n = xs.size();
+        origin = n > 0 ? bounds_min : Point::Zero();
+        Point extent = n > 0 ? Point(bounds_max - bounds_min) : Point::Zero();
+
+        // Coarsen the grid rather than allocating an unreasonable number of
+        // cells for tiny radii.
+        cell = cell_size;
+        const double max_cells = 1 << 24;
+        while ((double)(std::floor(extent[0] / cell) + 1) * (std::floor(extent[1] / cell) + 1) *
+                   (std::floor(extent[2] / cell) + 1) > max_cells)
+            cell *= 2;
+        for (int d = 0; d < 3; ++d)
+            dims[d] = (int)std::floor(extent[d] / cell) + 1;
+
+        // Counting sort of the points by cell. Points inserted since the
+        // last finalize are in insertion order, the others in cell order.
+        std::vector<int> order_ids = ids;
+        order_ids.resize(n);
+        for (int i = finalized ? n : (int)ids.size(); i < n; ++i)
+            order_ids[i] = i;
+        std::vector<Scalar> px, py, pz;
+        px.swap(xs);
+        py.swap(ys);
+        pz.swap(zs);
+
+        std::vector<int> point_cell(n);
+        cell_start.assign((size_t)dims[0] * dims[1] * dims[2] + 1, 0);
+        for (int k = 0; k < n; ++k)
+        {
+            point_cell[k] = cell_index(Point(px[k], py[k], pz[k]));
+            ++cell_start[point_cell[k] + 1];
+        }
+        for (size_t c = 1; c < cell_start.size(); ++c)
+            cell_start[c] += cell_start[c - 1];
+
+        std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+        ids.resize(n);
+        xs.resize(n);
+        ys.resize(n);
+        zs.resize(n);
+        for (int k = 0; k < n; ++k)
+        {
+            const int slot = fill[point_cell[k]]++;
+            ids[slot] = order_ids[k];
+            xs[slot] = px[k];
+            ys[slot] = py[k];
+            zs[slot] = pz[k];
+        }
+        finalized = true;
+    }
+
+    // Call visit(index, squared_distance) for every point within radius of q.
+    template <typename Visitor>
+    void for_each_in_radius(const Point &q, Scalar radius, Visitor &&visit) const
+    {
+        if (size() == 0)
+            return;
+        int lo[3], hi[3];
+        for (int d = 0; d < 3; ++d)
+        {
+            lo[d] = std::max(0, (int)std::floor((q[d] - radius - origin[d]) / cell));
+            hi[d] = std::min(dims[d] - 1, (int)std::floor((q[d] + radius - origin[d]) / cell));
+            if (lo[d] > hi[d])
+                return;
+        }
+        const Scalar r2 = radius * radius;
+        for (int z = lo[2]; z <= hi[2]; ++z)
+            for (int y = lo[1]; y <= hi[1]; ++y)
+            {
+                // Cells along x are adjacent, so the whole row is one range.
+                const size_t row = (size_t)dims[0] * (y + (size_t)dims[1] * z);
+                for (int k = cell_start[row + lo[0]]; k < cell_start[row + hi[0] + 1]; ++k)
+                {
+                    const Scalar dx = xs[k] - q[0], dy = ys[k] - q[1], dz = zs[k] - q[2];
+                    const Scalar d2 = dx * dx + dy * dy + dz * dz;
+                    if (d2 <= r2)
+                        visit(ids[k], d2);
+                }
+            }
+    }
+
+    // Collect the points strictly within radius of q into compacted lists,
+    // the batched counterpart of for_each_in_radius. The squared distances
+    // of each contiguous range of cells are computed with vectorised array
+    // expressions and written to the tail of out_d2, then compacted in place
+    // without branches, so points outside the radius are dropped before any
+    // further work is done on them. The output vectors only ever grow, so
+    // reusing them across queries avoids allocations.
+    //
+    // Outputs:
+    //   out_ids  original indices of the points found, in the first count
+    //            entries
+    //   out_d2  their squared distances to q
+    // Returns the number of points found.
+    int gather_in_radius(const Point &q, Scalar radius, std::vector<int> &out_ids, std::vector<Scalar> &out_d2) const
+    {
+        using Array = Eigen::Array<Scalar, Eigen::Dynamic, 1>;
+        if (size() == 0)
+            return 0;
+        int lo[3], hi[3];
+        for (int d = 0; d < 3; ++d)
+        {
+            lo[d] = std::max(0, (int)std::floor((q[d] - radius - origin[d]) / cell));
+            hi[d] = std::min(dims[d] - 1, (int)std::floor((q[d] + radius - origin[d]) / cell));
+            if (lo[d] > hi[d])
+                return 0;
+        }
+        const Scalar r2 = radius * radius;
+        int count = 0;
+        for (int z = lo[2]; z <= hi[2]; ++z)
+            for (int y = lo[1]; y <= hi[1]; ++y)
+            {
+                const size_t row = (size_t)dims[0] * (y + (size_t)dims[1] * z);
+                const int begin = cell_start[row + lo[0]];
+                const int length = cell_start[row + hi[0] + 1] - begin;
+                if (length == 0)
+                    continue;
+                if (out_d2.size() < (size_t)(count + length))
+                {
+                    out_d2.resize(2 * (count + length));
+                    out_ids.resize(2 * (count + length));
+                }
+                Eigen::Map<Array> d2(out_d2.data() + count, length);
+                d2 = (Eigen::Map<const Array>(xs.data() + begin, length) - q[0]).square() +
+                     (Eigen::Map<const Array>(ys.data() + begin, length) - q[1]).square() +
+                     (Eigen::Map<const Array>(zs.data() + begin, length) - q[2]).square();
+                // The write position never overtakes the read position.
+                for (int k = 0; k < length; ++k)
+                {
+                    const Scalar value = d2[k];
+                    out_d2[count] = value;
+                    out_ids[count] = ids[begin + k];
+                    count += value < r2;
+                }
+            }
+        return count;
+    }
+
+    // Number of points visible to queries.
+    int size() const { return finalized ? (int)ids.size() : 0; }
+
+private:
+    int cell_index(const Point &p) const
+    {
+        int c[3];
+        for (int d = 0; d < 3; ++d)
+            c[d] = std::min(dims[d] - 1, std::max(0, (int)std::floor((p[d] - origin[d]) / cell)));
+        return c[0] + dims[0] * (c[1] + dims[1] * c[2]);
+    }
+
+    Point bounds_min = Point::Constant(std::numeric_limits<Scalar>::max());
+    Point bounds_max = Point::Constant(std::numeric_limits<Scalar>::lowest());
+    bool finalized = true;
+
+    Point origin = Point::Zero();
+    Scalar cell = 1;
+    int dims[3] = {1, 1, 1};
+
+    // Points of cell c are the range [cell_start[c], cell_start[c + 1]).
+    std::vector<int> cell_start = std::vector<int>(1, 0);
+    // Original point index and coordinates, in cell order.
+    std::vector<int> ids;
+    std::vector<Scalar> xs, ys, zs;
+};
@@ -1,10 +1,19 @@
 #include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
 #include <igl/readOFF.h>
 #include <imgui.h>
 /*** insert any necessary libigl headers here ***/
 #include <igl/per_face_normals.h>
 #include <igl/copyleft/marching_cubes.h>
 #include <viewer_proxy.h>
+#include "CompactRBF.h"
+#include "ImplicitMLS.h"
+#include "MLS.h"
+#include "OctreeContouring.h"
+#include "PointCloudStream.h"
+#include "PolygonSoup.h"
 
 using namespace std;
 using Viewer = ViewerProxy;
@@ -15,6 +24,12 @@ Eigen::MatrixXd P;
 // Input: imported normals, #P x3
 Eigen::MatrixXd N;
 
+// Input: imported faces, the polygon soup used by key '5', #PF x3
+Eigen::MatrixXi PF;
+
+// Spatial index over P, built while loading the input
+SpatialGrid<double> P_index;
+
 // Normals evaluated via PCA method, #P x3
 Eigen::MatrixXd NP;
 
@@ -30,9 +45,36 @@ int polyDegree = 0;
 // Parameter: Wendland weight function radius (make this relative to the size of the mesh)
 double wendlandRadius = 0.1;
 
+// Parameter: initial offset of the constraints, relative to the bounding box
+// diagonal of the input points
+const double constraintEpsilon = 0.01;
+
 // Parameter: grid resolution
 int resolution = 20;
 
+// Parameter: implicit function evaluated on the grid, the MLS approximation or
+// the exact interpolation with compactly supported RBFs (see CompactRBF.h)
+const char *implicitMethods[] = {"MLS", "Compactly supported RBF"};
+enum { IMPLICIT_MLS, IMPLICIT_RBF };
+int implicitMethod = IMPLICIT_MLS;
+
+// Parameter: how key '4' extracts the mesh, marching cubes on the grid or
+// adaptive dual contouring of the MLS function on an octree
+const char *contouringMethods[] = {"Marching cubes", "Adaptive dual contouring"};
+enum { MARCHING_CUBES, ADAPTIVE_DUAL_CONTOURING };
+int contouringMethod = MARCHING_CUBES;
+
+// Parameter: options of the adaptive dual contouring
+OctreeContouringOptions octreeOptions;
+
+// Parameter: voxel size for downsampling streamed (PLY/XYZN) point clouds
+// while loading, in world units; 0 keeps every point
+double voxelSize = 0;
+
+// Parameter: evaluate MLS with the batched neighbour kernel rather than the
+// scalar per-neighbour loop, see ImplicitMLS::set_batched
+bool batchedKernel = true;
+
 // Intermediate result: grid points, at which the imlicit function will be evaluated, #G x3
 Eigen::MatrixXd grid_points;
 
@@ -55,14 +97,86 @@ Eigen::MatrixXi F;
 // Output: face normals of the reconstructed mesh, #F x3
 Eigen::MatrixXd FN;
 
+// Triangle BVH and quadrature data for the polygon soup implicit function
+PolygonSoupImplicit soup;
+
 // Functions
+bool loadPointCloud(const string &filename);
+double supportRadius();
+void buildConstraints();
 void createGrid();
-void evaluateImplicitFunc();
+bool evaluateImplicitFunc(vector<int> *neighbours = nullptr);
+void evaluateImplicitFunc_MLS(vector<int> *neighbours);
+bool evaluateImplicitFunc_CompactRBF();
 void evaluateImplicitFunc_PolygonSoup();
 void getLines();
+int adaptiveContouring();
 void pcaNormal();
 bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers);
 
+// Loads the input points and normals. OFF files are read with igl::readOFF;
+// PLY and XYZN files are streamed in chunks, filtered and optionally
+// downsampled (see PointCloudStream.h). Also builds P_index. The file is read
+// into local arrays, so P, N, PF and P_index keep the previous cloud if it
+// cannot be read or has no usable points.
+bool loadPointCloud(const string &filename)
+{
+    Eigen::MatrixXd points, normals;
+    Eigen::MatrixXi faces(0, 3);
+    SpatialGrid<double> index;
+    if (is_streamable_point_cloud(filename))
+    {
+        PointCloudStreamOptions options;
+        options.voxel_size = voxelSize;
+        if (!stream_point_cloud(filename, options, points, normals, &index))
+            return false;
+    }
+    else
+    {
+        if (!igl::readOFF(filename, points, faces, normals))
+            return false;
+        index.insert(points);
+    }
+    if (points.rows() == 0 || normals.rows() != points.rows())
+    {
+        cerr << filename << ": no usable points" << endl;
+        return false;
+    }
+    index.finalize(constraintEpsilon * (points.colwise().maxCoeff() - points.colwise().minCoeff()).norm());
+    P.swap(points);
+    N.swap(normals);
+    PF.swap(faces);
+    swap(P_index, index);
+    return true;
+}
+
+// Wendland support radius in world units; wendlandRadius is relative to the
+// bounding box diagonal of the input points.
+double supportRadius()
+{
+    return wendlandRadius * (P.colwise().maxCoeff() - P.colwise().minCoeff()).norm();
+}
+
+// Builds constrained_points and constrained_values from P and N, with the
+// neighbours found through P_index.
+void buildConstraints()
+{
+    const mls::Points<double> Ps = P, Ns = N;
+    mls::Points<double> C;
+    mls::Values<double> D;
+    const double eps = constraintEpsilon * mls::bounding_box_diagonal(Ps);
+    const SpatialGrid<double> *index = &P_index;
+    SpatialGrid<double> scratch;
+    if (P_index.size() != P.rows())
+    {
+        scratch.build(Ps, eps);
+        index = &scratch;
+    }
+    mls::build_constraints(Ps, Ns, *index, eps, C, D);
+    constrained_points = C;
+    constrained_values.swap(D);
+}
+
 // Creates a grid_points array for the simple sphere example. The points are
 // stacked into a single matrix, ordered first in the x, then in the y and
 // then in the z direction. If you find it necessary, replace this with your own
@@ -107,45 +221,67 @@ void createGrid()
     }
 }
 
-// Function for explicitly evaluating the implicit function for a sphere of
-// radius r centered at c : f(p) = ||p-c|| - r, where p = (x,y,z).
-// This will NOT produce valid results for any mesh other than the given
-// sphere.
-// Replace this with your own function for evaluating the implicit function
-// values at the grid points using MLS
-void evaluateImplicitFunc()
+// Evaluates the MLS approximation of the constraints at the grid points. The
+// grid is handed to ImplicitMLS in blocks of rows, so that no full copy of it
+// is made in the three-column layout of mls::Points.
+void evaluateImplicitFunc_MLS(vector<int> *neighbours)
 {
-    // Sphere center
-    auto bb_min = grid_points.colwise().minCoeff().eval();
-    auto bb_max = grid_points.colwise().maxCoeff().eval();
-    Eigen::RowVector3d center = 0.5 * (bb_min + bb_max);
-
-    double radius = 0.5 * (bb_max - bb_min).minCoeff();
-
-    // Scalar values of the grid points (the implicit function values)
-    grid_values.resize(resolution * resolution * resolution);
-
-    // Evaluate sphere's signed distance function at each gridpoint.
-    for (unsigned int x = 0; x < resolution; ++x)
+    ImplicitMLS<double> implicit;
+    implicit.set_constraints(constrained_points, constrained_values, supportRadius(), polyDegree);
+    implicit.set_batched(batchedKernel);
+
+    const int n = grid_points.rows(), block = 1 << 16;
+    grid_values.resize(n);
+    if (neighbours)
+        neighbours->resize(n);
+    mls::Points<double> X;
+    mls::Values<double> values;
+    vector<int> block_neighbours;
+    for (int begin = 0; begin < n; begin += block)
     {
-        for (unsigned int y = 0; y < resolution; ++y)
-        {
-            for (unsigned int z = 0; z < resolution; ++z)
-            {
-                // Linear index of the point at (x,y,z)
-                int index = x + resolution * (y + resolution * z);
+        const int size = min(block, n - begin);
+        X = grid_points.middleRows(begin, size);
+        implicit.eval(X, values, neighbours ? &block_neighbours : nullptr);
+        grid_values.segment(begin, size) = values;
+        if (neighbours)
+            copy(block_neighbours.begin(), block_neighbours.end(), neighbours->begin() + begin);
+    }
+}
 
-                // Value at (x,y,z) = implicit function for the sphere
-                grid_values[index] = (grid_points.row(index) - center).norm() - radius;
-            }
-        }
+// Interpolates the constraints with Wendland RBFs and evaluates the
+// interpolant at the grid points. The sparse system is factored once per call.
+// Returns false, leaving grid_values as they are, if the factorisation fails.
+bool evaluateImplicitFunc_CompactRBF()
+{
+    CompactRBF rbf;
+    if (!rbf.fit(constrained_points, constrained_values, supportRadius()))
+    {
+        cerr << "RBF interpolation failed, grid values not updated" << endl;
+        return false;
     }
+    rbf.eval(grid_points, grid_values);
+    return true;
 }
 
+// Evaluates the implicit function at the grid points using MLS or RBFs.
+// Assumes the constraints and the grid have been built. Optionally returns
+// the number of constraints in the support of each grid point (MLS only).
+// Returns false if the function could not be evaluated.
+bool evaluateImplicitFunc(vector<int> *neighbours)
+{
+    if (implicitMethod == IMPLICIT_RBF)
+        return evaluateImplicitFunc_CompactRBF();
+    evaluateImplicitFunc_MLS(neighbours);
+    return true;
+}
+
+// Approximation of the implicit surface from the polygon soup (P, PF), see
+// PolygonSoup.h. Triangles beyond the Wendland support of a grid point are
+// culled by the BVH, grid points are evaluated in parallel.
 void evaluateImplicitFunc_PolygonSoup()
 {
-    // Replace with your code here, for "key == '5'"
-    evaluateImplicitFunc();
+    soup.build(P, PF, supportRadius());
+    soup.evaluate(grid_points, grid_values);
 }
 
 // Code to display the grid lines given a grid structure of the given form.
@@ -186,6 +322,17 @@ void getLines()
     grid_lines.conservativeResize(numLines, Eigen::NoChange);
 }
 
+// Extracts (V, F) from the MLS function of the constraints with octree-based
+// adaptive dual contouring over the bounding box of the input points. The
+// octree needs gradients, so this always uses MLS, whatever implicitMethod is.
+// Returns the number of octree leaves.
+int adaptiveContouring()
+{
+    ImplicitMLS<double> implicit;
+    implicit.set_constraints(constrained_points, constrained_values, supportRadius(), polyDegree);
+    return octree_contour(implicit, P.colwise().minCoeff(), P.colwise().maxCoeff(), octreeOptions, V, F);
+}
+
 // Estimation of the normals via PCA.
 void pcaNormal()
 {
@@ -208,8 +355,16 @@ bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers)
         // Show all constraints
         viewer.data().clear();
         viewer.core().align_camera_center(P);
-        // Add your code for computing auxiliary constraint points here
-        // Add code for displaying all points, as above
+        buildConstraints();
+
+        // Input points in blue, outside constraints in red, inside in green
+        const int n = P.rows();
+        Eigen::MatrixXd colors(constrained_points.rows(), 3);
+        colors.topRows(n).rowwise() = Eigen::RowVector3d(0, 0, 1);
+        colors.middleRows(n, n).rowwise() = Eigen::RowVector3d(1, 0, 0);
+        colors.bottomRows(n).rowwise() = Eigen::RowVector3d(0, 1, 0);
+        viewer.data().point_size = 11;
+        viewer.data().add_points(constrained_points, colors);
     }
 
     if (key == '3')
@@ -217,17 +372,13 @@ bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers)
         // Show grid points with colored nodes and connected with lines
         viewer.data().clear();
         viewer.core().align_camera_center(P);
-        // Add code for creating a grid
-        // Add your code for evaluating the implicit function at the grid points
-        // Add code for displaying points and lines
-        // You can use the following example:
-
-        /*** begin: sphere example, replace (at least partially) with your code ***/
         // Make grid
         createGrid();
 
         // Evaluate implicit function
-        evaluateImplicitFunc();
+        buildConstraints();
+        if (!evaluateImplicitFunc())
+            return true;
 
         // get grid lines
         getLines();
@@ -257,25 +408,42 @@ bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers)
         viewer.data().add_edges(grid_lines.block(0, 0, grid_lines.rows(), 3),
                                 grid_lines.block(0, 3, grid_lines.rows(), 3),
                                 Eigen::RowVector3d(0.8, 0.8, 0.8));
-        /*** end: sphere example ***/
     }
 
     if (key == '4')
     {
         // Show reconstructed mesh
         viewer.data().clear();
-        // Code for computing the mesh (V,F) from grid_points and grid_values
-        if ((grid_points.rows() == 0) || (grid_values.rows() == 0))
+        if (contouringMethod == ADAPTIVE_DUAL_CONTOURING)
         {
-            cerr << "Not enough data for Marching Cubes !" << endl;
-            return true;
+            if (constrained_points.rows() == 0)
+            {
+                cerr << "Not enough data for adaptive contouring !" << endl;
+                return true;
+            }
+            int leaves = adaptiveContouring();
+            cout << "Adaptive contouring: " << leaves << " octree leaves, " << F.rows() << " faces" << endl;
+            if (V.rows() == 0)
+            {
+                cerr << "Adaptive contouring failed!" << endl;
+                return true;
+            }
         }
-        // Run marching cubes
-        igl::copyleft::marching_cubes(grid_values, grid_points, resolution, resolution, resolution, V, F);
-        if (V.rows() == 0)
+        else
         {
-            cerr << "Marching Cubes failed!" << endl;
-            return true;
+            // Code for computing the mesh (V,F) from grid_points and grid_values
+            if ((grid_points.rows() == 0) || (grid_values.rows() == 0))
+            {
+                cerr << "Not enough data for Marching Cubes !" << endl;
+                return true;
+            }
+            // Run marching cubes
+            igl::copyleft::marching_cubes(grid_values, grid_points, resolution, resolution, resolution, V, F);
+            if (V.rows() == 0)
+            {
+                cerr << "Marching Cubes failed!" << endl;
+                return true;
+            }
         }
 
         igl::per_face_normals(V, F, FN);
@@ -304,8 +472,12 @@ bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers)
         // get grid lines
         getLines();
 
-        // Display the reconstruction
+        // Display the reconstruction. The soup values only exist on the grid,
+        // so always use marching cubes and then restore the method.
+        int method = contouringMethod;
+        contouringMethod = MARCHING_CUBES;
         callback_key_down(viewer, '4', modifiers);
+        contouringMethod = method;
     }
 
     if (key == '6' || key == '7' || key == '8')
@@ -342,7 +514,8 @@ bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers)
 
 bool callback_load_mesh(Viewer &viewer, string filename)
 {
-    igl::readOFF(filename, P, F, N);
+    if (!loadPointCloud(filename))
+        return false;
     callback_key_down(viewer, '1', 0);
     return true;
 }
@@ -359,17 +532,161 @@ std::string find_data_dir() {
   throw "Could not find data directory";
 }
 
+// Splits a comma separated list, e.g. "20,40,60".
+template <typename T>
+vector<T> parseList(const string &list)
+{
+    vector<T> values;
+    stringstream tokens(list);
+    string token;
+    while (getline(tokens, token, ','))
+    {
+        stringstream value(token);
+        T v;
+        if (value >> v)
+            values.push_back(v);
+    }
+    return values;
+}
+
+// Headless benchmark of the MLS reconstruction:
+//   assignment2 --bench [--data cat,hound,luigi,sphere] [--res 20,40,60]
+//               [--radius 0.05,0.1,0.2] [--degree 0,1,2]
+//               [--method mls,rbf] [--kernel batched,scalar]
+//               [--out results.csv]
+// Sweeps all combinations of the parameters on every dataset and writes one
+// CSV row per run with the time of each phase of the pipeline (constraints,
+// grid, evaluation, getLines, marching cubes) and the number of constraints
+// in the support of the grid points. Columns that do not apply to the RBF
+// method (kernel, degree, neighbours) are n/a for it.
+int runBenchmark(int argc, char *argv[])
+{
+    vector<string> datasets = {"cat", "hound", "luigi", "sphere"};
+    vector<int> resolutions = {20, 40, 60};
+    vector<double> radii = {0.05, 0.1, 0.2};
+    vector<int> degrees = {0, 1, 2};
+    vector<string> methods = {"mls"};
+    vector<string> kernels = {"batched"};
+    string out;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--data")
+            datasets = parseList<string>(value);
+        else if (option == "--res")
+            resolutions = parseList<int>(value);
+        else if (option == "--radius")
+            radii = parseList<double>(value);
+        else if (option == "--degree")
+            degrees = parseList<int>(value);
+        else if (option == "--method")
+            methods = parseList<string>(value);
+        else if (option == "--kernel")
+            kernels = parseList<string>(value);
+        else if (option == "--out")
+            out = value;
+        else
+        {
+            cerr << "Unknown benchmark option " << option << endl;
+            return 1;
+        }
+    }
+
+    ofstream file;
+    if (!out.empty())
+        file.open(out);
+    ostream &csv = out.empty() ? cout : file;
+    csv << "dataset,points,method,kernel,resolution,wendland_radius,poly_degree,"
+           "constraints_ms,grid_ms,evaluate_ms,lines_ms,marching_cubes_ms,total_ms,"
+           "grid_points_per_s,avg_neighbours,max_neighbours,vertices,faces"
+        << endl;
+
+    using Clock = chrono::steady_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return chrono::duration<double, milli>(b - a).count();
+    };
+
+    for (const string &dataset : datasets)
+    {
+        string filename = dataset;
+        if (filename.find('.') == string::npos)
+            filename = find_data_dir() + dataset + ".off";
+        if (!loadPointCloud(filename))
+        {
+            cerr << "Could not load " << filename << endl;
+            continue;
+        }
+        for (const string &method : methods)
+        {
+            // The RBF interpolation has no kernel variants or polynomial
+            // degree; it runs once per resolution and radius with
+            // those columns set to n/a.
+            const bool rbf = method == "rbf";
+            const vector<string> method_kernels = rbf ? vector<string>{"n/a"} : kernels;
+            const vector<int> method_degrees = rbf ? vector<int>{-1} : degrees;
+        for (const string &kernel : method_kernels)
+            for (int res : resolutions)
+                for (double radius : radii)
+                    for (int degree : method_degrees)
+                    {
+                        implicitMethod = rbf ? IMPLICIT_RBF : IMPLICIT_MLS;
+                        batchedKernel = kernel != "scalar";
+                        resolution = res;
+                        wendlandRadius = radius;
+                        polyDegree = max(degree, 0);
+                        vector<int> neighbours;
+
+                        auto t0 = Clock::now();
+                        buildConstraints();
+                        auto t1 = Clock::now();
+                        createGrid();
+                        auto t2 = Clock::now();
+                        if (!evaluateImplicitFunc(&neighbours))
+                            continue;
+                        auto t3 = Clock::now();
+                        getLines();
+                        auto t4 = Clock::now();
+                        igl::copyleft::marching_cubes(grid_values, grid_points, resolution, resolution,
+                                                      resolution, V, F);
+                        auto t5 = Clock::now();
+
+                        long sum = 0;
+                        int max_count = 0;
+                        for (int count : neighbours)
+                        {
+                            sum += count;
+                            max_count = max(max_count, count);
+                        }
+                        const double evaluate_ms = ms(t2, t3);
+                        csv << dataset << ',' << P.rows() << ',' << method << ',' << kernel << ',' << res << ',' << radius
+                            << ',' << (rbf ? "n/a" : to_string(degree)) << ',' << ms(t0, t1) << ',' << ms(t1, t2) << ',' << evaluate_ms
+                            << ',' << ms(t3, t4) << ',' << ms(t4, t5) << ',' << ms(t0, t5) << ','
+                            << grid_points.rows() / max(evaluate_ms, 1e-6) * 1000 << ','
+                            << (rbf ? "n/a" : to_string((double)sum / max<size_t>(neighbours.size(), 1))) << ','
+                            << (rbf ? "n/a" : to_string(max_count)) << ','
+                            << V.rows() << ',' << F.rows() << endl;
+                    }
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    if (argc > 1 && string(argv[1]) == "--bench")
+        return runBenchmark(argc, argv);
+
+    if (argc < 2)
     {
-        cout << "Usage ex2_bin <mesh.off>" << endl;
-        igl::readOFF(find_data_dir() + "/sphere.off", P, F, N);
+        cout << "Usage ex2_bin <mesh.off|points.ply|points.xyzn> [voxel size]" << endl;
+        loadPointCloud(find_data_dir() + "/sphere.off");
     }
     else
     {
         // Read points and normals
-        igl::readOFF(argv[1], P, F, N);
+        if (argc > 2)
+            voxelSize = atof(argv[2]);
+        loadPointCloud(argv[1]);
     }
 
     Viewer& viewer = Viewer::get_instance();
@@ -396,6 +713,17 @@ int main(int argc, char *argv[])
                 callback_key_down(viewer, '3', 0);
             }
 
+            ImGui::InputDouble("Wendland radius", &wendlandRadius, 0, 0);
+            ImGui::SliderInt("Polynomial degree", &polyDegree, 0, 2);
+            ImGui::Combo("Implicit function", &implicitMethod, implicitMethods, IM_ARRAYSIZE(implicitMethods));
+            ImGui::Combo("Contouring", &contouringMethod, contouringMethods, IM_ARRAYSIZE(contouringMethods));
+            if (contouringMethod == ADAPTIVE_DUAL_CONTOURING)
+            {
+                ImGui::SliderInt("Octree min depth", &octreeOptions.min_depth, 0, 8);
+                ImGui::SliderInt("Octree max depth", &octreeOptions.max_depth, 1, 10);
+                ImGui::InputDouble("Normal angle", &octreeOptions.normal_angle, 0, 0);
+            }
+
             // TODO: Add more parameters to tweak here...
         }
     };
@@ -0,0 +1,132 @@
+#include "BilateralDenoiser.h"
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <igl/parallel_for.h>
+
+using namespace std;
+
+void BilateralDenoiser::set_neighbourhoods(const Eigen::MatrixXd& V, double radius) {
+    const int n = V.rows();
+    neighbourhood_radius = radius;
+    start.assign(n + 1, 0);
+    neighbours.clear();
+    if (!(radius > 0) || n == 0)
+        return;
+
+    // Spatial hash: a uniform grid of cells of size radius, coarsened if it
+    // would get too large, with the vertices sorted by cell.
+    const Eigen::RowVector3d origin = V.colwise().minCoeff();
+    const Eigen::RowVector3d extent = V.colwise().maxCoeff() - origin;
+    double cell = max(radius, 1e-12);
+    while ((floor(extent[0] / cell) + 1) * (floor(extent[1] / cell) + 1) * (floor(extent[2] / cell) + 1) > (1 << 24))
+        cell *= 2;
+    int dims[3];
+    for (int d = 0; d < 3; ++d)
+        dims[d] = (int)floor(extent[d] / cell) + 1;
+    auto cell_of = [&](int i, int d) { return min(dims[d] - 1, (int)floor((V(i, d) - origin[d]) / cell)); };
+
+    vector<int> cell_start((size_t)dims[0] * dims[1] * dims[2] + 1, 0), vertex_cell(n), sorted(n);
+    for (int i = 0; i < n; ++i) {
+        vertex_cell[i] = cell_of(i, 0) + dims[0] * (cell_of(i, 1) + dims[1] * cell_of(i, 2));
+        ++cell_start[vertex_cell[i] + 1];
+    }
+    for (size_t c = 1; c < cell_start.size(); ++c)
+        cell_start[c] += cell_start[c - 1];
+    vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+    for (int i = 0; i < n; ++i)
+        sorted[fill[vertex_cell[i]]++] = i;
+
+    // Two passes over the vertices, counting and then writing the CSR rows.
+    const double r2 = radius * radius;
+    auto for_each_neighbour = [&](int i, auto&& visit) {
+        int lo[3], hi[3];
+        for (int d = 0; d < 3; ++d) {
+            lo[d] = max(0, (int)floor((V(i, d) - radius - origin[d]) / cell));
+            hi[d] = min(dims[d] - 1, (int)floor((V(i, d) + radius - origin[d]) / cell));
+        }
+        for (int z = lo[2]; z <= hi[2]; ++z)
+            for (int y = lo[1]; y <= hi[1]; ++y) {
+                const size_t row = (size_t)dims[0] * (y + (size_t)dims[1] * z);
+                for (int k = cell_start[row + lo[0]]; k < cell_start[row + hi[0] + 1]; ++k) {
+                    const int j = sorted[k];
+                    if (j != i && (V.row(j) - V.row(i)).squaredNorm() <= r2)
+                        visit(j);
+                }
+            }
+    };
+    igl::parallel_for(n, [&](int i) {
+        int count = 0;
+        for_each_neighbour(i, [&](int) { ++count; });
+        start[i + 1] = count;
+    }, 1000);
+    for (int i = 0; i < n; ++i)
+        start[i + 1] += start[i];
+    neighbours.resize(start[n]);
+    igl::parallel_for(n, [&](int i) {
+        int slot = start[i];
+        for_each_neighbour(i, [&](int j) { neighbours[slot++] = j; });
+    }, 1000);
+}
+
+void BilateralDenoiser::update_normals(const DifferentialGeometryCache& g, const double* p) {
+    const Eigen::MatrixXi& F = g.F;
+    face_normals.resize(F.rows(), 3);
+    normals.resize(g.num_vertices(), 3);
+    // Area-weighted face normals (the cross product has twice the area as
+    // its length), then their sum per vertex.
+    igl::parallel_for(F.rows(), [&](int f) {
+        const Eigen::Vector3d a(p + 3 * F(f, 0)), b(p + 3 * F(f, 1)), c(p + 3 * F(f, 2));
+        face_normals.row(f) = (b - a).cross(c - a).transpose();
+    }, 1000);
+    igl::parallel_for(g.num_vertices(), [&](int i) {
+        Eigen::RowVector3d sum = Eigen::RowVector3d::Zero();
+        for (int k = g.vf_start[i]; k < g.vf_start[i + 1]; ++k)
+            sum += face_normals.row(g.vf[k]);
+        const double length = sum.norm();
+        normals.row(i) = length > 0 ? Eigen::RowVector3d(sum / length) : sum;
+    }, 1000);
+}
+
+void BilateralDenoiser::denoise(const DifferentialGeometryCache& g, double sigma_c, int iterations,
+                                Eigen::MatrixXd& V) {
+    if (iterations <= 0 || !(sigma_c > 0))
+        return;
+    const int n = V.rows();
+    buffers[0] = V;
+    buffers[1].resize(n, 3);
+    const double c2 = 2 * sigma_c * sigma_c;
+    for (int it = 0; it < iterations; ++it) {
+        const double* in = buffers[it % 2].data();
+        double* out = buffers[(it + 1) % 2].data();
+        update_normals(g, in);
+        igl::parallel_for(n, [&](int i) {
+            const Eigen::Map<const Eigen::RowVector3d> v(in + 3 * i);
+            const Eigen::RowVector3d normal = normals.row(i);
+            const int begin = start[i], end = start[i + 1];
+
+            // sigma_s from the spread of the heights in the neighbourhood.
+            double mean = 0, mean2 = 0;
+            for (int k = begin; k < end; ++k) {
+                const double h = normal.dot(v - Eigen::Map<const Eigen::RowVector3d>(in + 3 * neighbours[k]));
+                mean += h;
+                mean2 += h * h;
+            }
+            const int count = end - begin;
+            const double variance = count > 0 ? max(mean2 / count - (mean / count) * (mean / count), 0.0) : 0;
+            const double s2 = 2 * max(variance, 1e-24);
+
+            double sum = 0, normalizer = 0;
+            for (int k = begin; k < end; ++k) {
+                const Eigen::RowVector3d d = v - Eigen::Map<const Eigen::RowVector3d>(in + 3 * neighbours[k]);
+                const double h = normal.dot(d);
+                const double w = exp(-d.squaredNorm() / c2) * exp(-h * h / s2);
+                sum += w * h;
+                normalizer += w;
+            }
+            Eigen::Map<Eigen::RowVector3d> result(out + 3 * i);
+            result = normalizer > 0 ? Eigen::RowVector3d(v - normal * (sum / normalizer)) : Eigen::RowVector3d(v);
+        }, 1000);
+    }
+    V = buffers[iterations % 2];
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <Eigen/Core>
+#include <vector>
+#include "DifferentialGeometryCache.h"
+
+// Bilateral mesh denoising (Fleishman et al. 2003).
+//
+// Every vertex moves along its normal n by the bilaterally weighted average
+// of the heights h = n.(v - q) of the vertices q within 2 sigma_c,
+//
+//   v' = v - n sum(w_c w_s h) / sum(w_c w_s),
+//   w_c = exp(-|v - q|^2 / 2 sigma_c^2),  w_s = exp(-h^2 / 2 sigma_s^2),
+//
+// with sigma_s the standard deviation of the heights in the neighbourhood.
+// The neighbourhoods are gathered once with a spatial hash and stored in CSR
+// form; the iterations update all vertices in parallel from one buffer into
+// the other and refresh the area-weighted normals in place in between.
+class BilateralDenoiser {
+public:
+    // Gather the vertices within radius of every vertex of V. A radius that is
+    // not positive leaves every neighbourhood empty.
+    void set_neighbourhoods(const Eigen::MatrixXd& V, double radius);
+
+    // Run the given number of iterations on V in place. The topology of the
+    // cache is used to refresh the normals. V is left unchanged unless sigma_c
+    // and iterations are positive.
+    void denoise(const DifferentialGeometryCache& geometry, double sigma_c, int iterations, Eigen::MatrixXd& V);
+
+    // Radius of the current neighbourhoods.
+    double radius() const { return neighbourhood_radius; }
+
+private:
+    void update_normals(const DifferentialGeometryCache& geometry, const double* positions);
+
+    double neighbourhood_radius = 0;
+    // Neighbours of vertex i, itself excluded, are
+    // neighbours[start[i]] .. neighbours[start[i + 1] - 1].
+    std::vector<int> start, neighbours;
+    Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> buffers[2], face_normals, normals;
+};
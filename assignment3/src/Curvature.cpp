@@ -0,0 +1,116 @@
+#include "Curvature.h"
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <igl/parallel_for.h>
+
+using namespace std;
+
+void compute_curvatures(const Eigen::MatrixXd& V, const DifferentialGeometryCache& g, const Eigen::MatrixXd& N,
+                        Curvatures& K) {
+    const int n = V.rows();
+    K.mean.resize(n);
+    K.gaussian.resize(n);
+    K.min.resize(n);
+    K.max.resize(n);
+    K.dir_min.resize(n, 3);
+    K.dir_max.resize(n, 3);
+
+    igl::parallel_for(n, [&](int i) {
+        const Eigen::RowVector3d p = V.row(i), normal = N.row(i);
+        const int first = g.ring_start[i], valence = g.ring_start[i + 1] - first;
+        const double area = g.voronoi_areas(i);
+
+        // Mean curvature from the cotangent Laplacian, Delta x = -2 H n.
+        Eigen::RowVector3d laplacian = Eigen::RowVector3d::Zero();
+        for (int k = first; k < first + valence; ++k)
+            laplacian += g.ring_cotangents[k] * (V.row(g.ring[k]) - p);
+        if (area > 0)
+            laplacian /= area;
+        const double H = (laplacian.dot(normal) > 0 ? -0.5 : 0.5) * laplacian.norm();
+
+        // Gaussian curvature from the angle defect.
+        const double defect = (g.boundary[i] ? M_PI : 2 * M_PI) - g.angle_sums(i);
+        const double KG = area > 0 ? defect / area : 0;
+
+        const double discriminant = sqrt(max(H * H - KG, 0.0));
+        K.mean(i) = H;
+        K.gaussian(i) = KG;
+        K.min(i) = H - discriminant;
+        K.max(i) = H + discriminant;
+
+        // Edge weights: area of the faces adjacent to each ring edge. The
+        // valence is small, so they live in a fixed-size buffer when possible.
+        double local[32];
+        vector<double> heap;
+        double* weights = local;
+        if (valence > 32) {
+            heap.resize(valence);
+            weights = heap.data();
+        }
+        fill_n(weights, valence, 0.0);
+        const auto ring_begin = g.ring.begin() + first, ring_end = ring_begin + valence;
+        for (int k = g.vf_start[i]; k < g.vf_start[i + 1]; ++k) {
+            const int f = g.vf[k], c = g.vf_corner[k];
+            weights[lower_bound(ring_begin, ring_end, g.F(f, (c + 1) % 3)) - ring_begin] += g.face_areas(f);
+            weights[lower_bound(ring_begin, ring_end, g.F(f, (c + 2) % 3)) - ring_begin] += g.face_areas(f);
+        }
+
+        // The principal directions are the rotation of the tangential tensor
+        // with eigenvalues (min, max) that best fits the normal curvatures in
+        // the weighted least squares sense. Along a unit tangent t at angle phi
+        // from the max direction theta, t^T S t = H + D cos(2 (phi - theta))
+        // with D the discriminant, so with u = (cos 2 theta, sin 2 theta) and
+        // c = (cos 2 phi, sin 2 phi) the error is
+        //   sum w (D u.c - (k - H))^2 = D^2 u^T G u - 2 D u^T b + const,
+        // G = sum w c c^T, b = sum w (k - H) c.
+        const Eigen::Vector3d nv = normal.transpose();
+        const Eigen::Vector3d t1 = nv.unitOrthogonal(), t2 = nv.cross(t1);
+        Eigen::Matrix2d G = Eigen::Matrix2d::Zero();
+        Eigen::Vector2d b = Eigen::Vector2d::Zero();
+        for (int k = 0; k < valence; ++k) {
+            const Eigen::Vector3d e = (V.row(g.ring[first + k]) - p).transpose();
+            const double length2 = e.squaredNorm();
+            Eigen::Vector2d t(e.dot(t1), e.dot(t2));
+            if (length2 == 0 || t.squaredNorm() == 0)
+                continue;
+            t.normalize();
+            const double kappa = -2 * nv.dot(e) / length2;
+            const Eigen::Vector2d c(t.x() * t.x() - t.y() * t.y(), 2 * t.x() * t.y());
+            G += weights[k] * c * c.transpose();
+            b += weights[k] * (kappa - H) * c;
+        }
+        // Minimise over alpha = 2 theta. The error is a trigonometric
+        // polynomial of degree 2, so start from the best of a few samples and
+        // refine with Newton steps. At an umbilic (D = 0) any direction fits;
+        // take the orientation of b.
+        const double D = discriminant;
+        auto error = [&](double alpha) {
+            const Eigen::Vector2d u(cos(alpha), sin(alpha));
+            return D * D * u.dot(G * u) - 2 * D * u.dot(b);
+        };
+        double alpha = atan2(b.y(), b.x());
+        if (D > 0) {
+            double best = error(alpha);
+            for (int sample = 0; sample < 16; ++sample) {
+                const double candidate = sample * M_PI / 8, value = error(candidate);
+                if (value < best) {
+                    best = value;
+                    alpha = candidate;
+                }
+            }
+            const double g1 = 0.5 * (G(0, 0) - G(1, 1)), g2 = G(0, 1);
+            for (int step = 0; step < 4; ++step) {
+                const double c1 = cos(alpha), s1 = sin(alpha), c2 = cos(2 * alpha), s2 = sin(2 * alpha);
+                const double slope = D * D * (-2 * g1 * s2 + 2 * g2 * c2) - 2 * D * (-b.x() * s1 + b.y() * c1);
+                const double bend = D * D * (-4 * g1 * c2 - 4 * g2 * s2) + 2 * D * (b.x() * c1 + b.y() * s1);
+                if (bend <= 0)
+                    break;
+                alpha -= slope / bend;
+            }
+        }
+        const double theta = 0.5 * alpha;
+        K.dir_max.row(i) = (cos(theta) * t1 + sin(theta) * t2).transpose();
+        K.dir_min.row(i) = (-sin(theta) * t1 + cos(theta) * t2).transpose();
+    }, 1000);
+}
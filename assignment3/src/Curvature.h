@@ -0,0 +1,36 @@
+#pragma once
+#include <Eigen/Core>
+#include "DifferentialGeometryCache.h"
+
+// All discrete curvatures of a mesh, positive where the surface is convex
+// with respect to the normals.
+struct Curvatures {
+    // Mean and Gaussian curvature, #V
+    Eigen::VectorXd mean, gaussian;
+    // Minimal and maximal principal curvature, #V
+    Eigen::VectorXd min, max;
+    // Unit principal directions, #V x3
+    Eigen::MatrixXd dir_min, dir_max;
+};
+
+// Compute all curvatures in one parallel pass over the vertices, from the
+// angle sums, mixed Voronoi areas and cotangent weights of the cache (Meyer
+// et al. 2003):
+//   mean       |Delta x| / 2, from the cotangent Laplacian of the positions
+//   Gaussian   angle defect / mixed area (defect against pi on the boundary)
+//   min, max   H -/+ sqrt(max(H^2 - K, 0))
+// The principal directions come from the same tensor: the rotation theta of
+// S = R(theta) diag(max, min) R(theta)^T that best fits t_ij^T S t_ij = k_ij
+// over the one-ring in the weighted least squares sense, as in Meyer et al.,
+// where t_ij is the unit tangent direction of edge ij,
+// k_ij = 2 n.(x_i - x_j) / |x_i - x_j|^2 the normal curvature along it, and the
+// weight the area of the faces adjacent to the edge.
+//
+// Inputs:
+//   V  #V x3 vertex positions, the ones the cache was computed for
+//   geometry  up-to-date geometry cache of the mesh
+//   N  #V x3 unit vertex normals
+// Outputs:
+//   K  curvatures
+void compute_curvatures(const Eigen::MatrixXd& V, const DifferentialGeometryCache& geometry, const Eigen::MatrixXd& N,
+                        Curvatures& K);
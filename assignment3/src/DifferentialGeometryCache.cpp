@@ -0,0 +1,136 @@
+#include "DifferentialGeometryCache.h"
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <igl/parallel_for.h>
+
+using namespace std;
+
+void DifferentialGeometryCache::set_mesh(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F_) {
+    F = F_;
+    const int n = V.rows();
+
+    // Vertex-face incidences by counting sort.
+    vf_start.assign(n + 1, 0);
+    for (int f = 0; f < F.rows(); ++f)
+        for (int c = 0; c < 3; ++c)
+            ++vf_start[F(f, c) + 1];
+    for (int i = 0; i < n; ++i)
+        vf_start[i + 1] += vf_start[i];
+    vf.resize(vf_start[n]);
+    vf_corner.resize(vf_start[n]);
+    vector<int> fill(vf_start.begin(), vf_start.end() - 1);
+    for (int f = 0; f < F.rows(); ++f)
+        for (int c = 0; c < 3; ++c) {
+            const int slot = fill[F(f, c)]++;
+            vf[slot] = f;
+            vf_corner[slot] = c;
+        }
+
+    // One-rings: the other two vertices of every incident face, deduplicated
+    // in a scratch array with room for two entries per incidence, then
+    // compacted. A vertex is on the boundary if one of its edges belongs to a
+    // single face, i.e. appears once.
+    vector<int> scratch(2 * vf.size());
+    vector<int> count(n + 1, 0);
+    boundary.assign(n, false);
+    vector<char> on_boundary(n, 0);
+    igl::parallel_for(n, [&](int i) {
+        int* begin = scratch.data() + 2 * vf_start[i];
+        int* end = begin;
+        for (int k = vf_start[i]; k < vf_start[i + 1]; ++k) {
+            const int f = vf[k], c = vf_corner[k];
+            *end++ = F(f, (c + 1) % 3);
+            *end++ = F(f, (c + 2) % 3);
+        }
+        sort(begin, end);
+        int unique = 0;
+        for (int* p = begin; p != end;) {
+            int* q = p;
+            while (q != end && *q == *p)
+                ++q;
+            if (q - p == 1)
+                on_boundary[i] = 1;
+            begin[unique++] = *p;
+            p = q;
+        }
+        count[i + 1] = unique;
+    }, 1000);
+    ring_start.assign(n + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        ring_start[i + 1] = ring_start[i] + count[i + 1];
+        boundary[i] = on_boundary[i];
+    }
+    ring.resize(ring_start[n]);
+    igl::parallel_for(n, [&](int i) {
+        copy_n(scratch.begin() + 2 * vf_start[i], count[i + 1], ring.begin() + ring_start[i]);
+    }, 1000);
+
+    update(V);
+}
+
+void DifferentialGeometryCache::update(const Eigen::MatrixXd& V) {
+    const int n = num_vertices();
+    const int m = F.rows();
+    face_areas.resize(m);
+    face_normals.resize(m, 3);
+    corner_angles.resize(m, 3);
+    corner_cotangents.resize(m, 3);
+    corner_areas.resize(m, 3);
+
+    igl::parallel_for(m, [&](int f) {
+        Eigen::Vector3d p[3];
+        for (int c = 0; c < 3; ++c)
+            p[c] = V.row(F(f, c)).transpose();
+        const Eigen::Vector3d normal = (p[1] - p[0]).cross(p[2] - p[0]);
+        const double double_area = normal.norm();
+        face_areas(f) = 0.5 * double_area;
+        face_normals.row(f) = double_area > 0 ? Eigen::Vector3d(normal / double_area) : Eigen::Vector3d::Zero();
+
+        double squared_lengths[3];
+        bool obtuse = false;
+        for (int c = 0; c < 3; ++c) {
+            const Eigen::Vector3d a = p[(c + 1) % 3] - p[c], b = p[(c + 2) % 3] - p[c];
+            const double dot = a.dot(b);
+            corner_angles(f, c) = atan2(double_area, dot);
+            corner_cotangents(f, c) = double_area > 0 ? dot / double_area : 0;
+            obtuse = obtuse || dot < 0;
+            // Length of the edge opposite to corner c.
+            squared_lengths[c] = (p[(c + 2) % 3] - p[(c + 1) % 3]).squaredNorm();
+        }
+
+        // Mixed Voronoi cells (Meyer et al. 2003): the circumcentric cell for
+        // non-obtuse triangles, otherwise half of the area to the obtuse
+        // corner and a quarter to the others.
+        for (int c = 0; c < 3; ++c) {
+            const int c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+            if (!obtuse)
+                corner_areas(f, c) = (squared_lengths[c2] * corner_cotangents(f, c2) +
+                                      squared_lengths[c1] * corner_cotangents(f, c1)) / 8;
+            else
+                corner_areas(f, c) = face_areas(f) * (corner_angles(f, c) > M_PI / 2 ? 0.5 : 0.25);
+        }
+    }, 1000);
+
+    // Gather per vertex, so every entry is written by one thread only.
+    ring_cotangents.assign(ring.size(), 0);
+    voronoi_areas.resize(n);
+    angle_sums.resize(n);
+    igl::parallel_for(n, [&](int i) {
+        const auto first = ring.begin() + ring_start[i], last = ring.begin() + ring_start[i + 1];
+        double area = 0, angle = 0;
+        for (int k = vf_start[i]; k < vf_start[i + 1]; ++k) {
+            const int f = vf[k], c = vf_corner[k];
+            const int c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+            area += corner_areas(f, c);
+            angle += corner_angles(f, c);
+            // Edge (i, F(f, c1)) is opposite to corner c2 and vice versa.
+            ring_cotangents[lower_bound(first, last, F(f, c1)) - ring.begin()] += corner_cotangents(f, c2) / 2;
+            ring_cotangents[lower_bound(first, last, F(f, c2)) - ring.begin()] += corner_cotangents(f, c1) / 2;
+        }
+        voronoi_areas(i) = area;
+        angle_sums(i) = angle;
+    }, 1000);
+
+    geometry_valid = true;
+}
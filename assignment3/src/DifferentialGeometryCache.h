@@ -0,0 +1,61 @@
+#pragma once
+#include <Eigen/Core>
+#include <vector>
+
+// Per-mesh tables shared by the normal, curvature and smoothing operators.
+//
+// The topology (one-rings and vertex-face incidences, in CSR form) depends on
+// F only and is built by set_mesh. The geometric quantities depend on V and
+// are recomputed by update in one parallel pass over the faces followed by one
+// parallel gather over the vertices. invalidate() marks them stale after V
+// has changed; valid() tells whether they can be used as is.
+class DifferentialGeometryCache {
+public:
+    // Build the topology of F and the geometry of V.
+    void set_mesh(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F);
+
+    // Recompute the geometric quantities for new vertex positions, keeping
+    // the topology.
+    void update(const Eigen::MatrixXd& V);
+
+    void invalidate() { geometry_valid = false; }
+    bool valid() const { return geometry_valid; }
+
+    int num_vertices() const { return (int)ring_start.size() - 1; }
+    int num_faces() const { return (int)F.rows(); }
+
+    // Topology.
+    Eigen::MatrixXi F;
+    // Neighbours of vertex i are ring[ring_start[i]] .. ring[ring_start[i + 1] - 1],
+    // sorted by index.
+    std::vector<int> ring_start, ring;
+    // Faces incident to vertex i are vf[vf_start[i]] .. vf[vf_start[i + 1] - 1],
+    // and vf_corner holds the corner (0, 1, 2) of i in each of them.
+    std::vector<int> vf_start, vf, vf_corner;
+    // Whether each vertex lies on the boundary.
+    std::vector<bool> boundary;
+
+    // Geometry, per face.
+    // Face areas, #F
+    Eigen::VectorXd face_areas;
+    // Unit face normals, #F x3
+    Eigen::MatrixXd face_normals;
+    // Interior angle at each corner, #F x3
+    Eigen::MatrixXd corner_angles;
+    // Cotangent of the angle at each corner, #F x3
+    Eigen::MatrixXd corner_cotangents;
+    // Part of the face in the mixed Voronoi cell of each corner, #F x3
+    Eigen::MatrixXd corner_areas;
+
+    // Geometry, per vertex.
+    // Cotangent weight (cot alpha + cot beta) / 2 of each one-ring edge,
+    // aligned with ring
+    std::vector<double> ring_cotangents;
+    // Mixed Voronoi areas, #V
+    Eigen::VectorXd voronoi_areas;
+    // Sum of the corner angles around each vertex, #V
+    Eigen::VectorXd angle_sums;
+
+private:
+    bool geometry_valid = false;
+};
@@ -0,0 +1,46 @@
+#include "ExplicitSmoother.h"
+#include <igl/parallel_for.h>
+
+void ExplicitSmoother::set_laplacian(const Eigen::SparseMatrix<double>& L) {
+    A = L;
+    A.prune([](int row, int col, double) { return row != col; });
+    A.makeCompressed();
+    igl::parallel_for(A.rows(), [&](int i) {
+        const int begin = A.outerIndexPtr()[i], end = A.outerIndexPtr()[i + 1];
+        double* w = A.valuePtr();
+        double sum = 0;
+        for (int k = begin; k < end; ++k)
+            sum += w[k];
+        for (int k = begin; k < end; ++k)
+            w[k] = sum > 0 ? w[k] / sum : 1.0 / (end - begin);
+    }, 1000);
+}
+
+void ExplicitSmoother::smooth(Eigen::MatrixXd& V, double lambda, int iterations) {
+    const int n = V.rows();
+    buffers[0] = V;
+    buffers[1].resize(n, 3);
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    const double* w = A.valuePtr();
+    for (int it = 0; it < iterations; ++it) {
+        const double* in = buffers[it % 2].data();
+        double* out = buffers[(it + 1) % 2].data();
+        igl::parallel_for(n, [&](int i) {
+            double x = 0, y = 0, z = 0;
+            for (int k = outer[i]; k < outer[i + 1]; ++k) {
+                const double* p = in + 3 * inner[k];
+                x += w[k] * p[0];
+                y += w[k] * p[1];
+                z += w[k] * p[2];
+            }
+            const double* p = in + 3 * i;
+            if (outer[i] == outer[i + 1])
+                x = p[0], y = p[1], z = p[2];
+            out[3 * i] = p[0] + lambda * (x - p[0]);
+            out[3 * i + 1] = p[1] + lambda * (y - p[1]);
+            out[3 * i + 2] = p[2] + lambda * (z - p[2]);
+        }, 1000);
+    }
+    V = buffers[iterations % 2];
+}
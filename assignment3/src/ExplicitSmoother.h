@@ -0,0 +1,26 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+// Explicit Laplacian smoothing, v_i <- v_i + lambda (sum_j a_ij v_j - v_i),
+// where a_ij are the Laplacian weights of row i normalised to sum to one.
+//
+// The weights are kept in a row-major CSR matrix without the diagonal. Each
+// iteration is a single parallel sweep over the rows that gathers all three
+// coordinates of the neighbours at once and writes the updated position to
+// the other of two interleaved (row-major) buffers, so running many
+// iterations allocates nothing.
+class ExplicitSmoother {
+public:
+    // Take the weights from a Laplacian with non-positive diagonal, e.g. the
+    // cotangent Laplacian. Rows whose weights do not sum to a positive value
+    // fall back to uniform weights.
+    void set_laplacian(const Eigen::SparseMatrix<double>& L);
+
+    // Run the given number of iterations on V in place.
+    void smooth(Eigen::MatrixXd& V, double lambda, int iterations);
+
+private:
+    Eigen::SparseMatrix<double, Eigen::RowMajor> A;
+    Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> buffers[2];
+};
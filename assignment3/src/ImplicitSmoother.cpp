@@ -0,0 +1,68 @@
+#include "ImplicitSmoother.h"
+#include <algorithm>
+#include <igl/parallel_for.h>
+#include <iostream>
+
+using namespace std;
+
+void ImplicitSmoother::set_pattern(const Eigen::SparseMatrix<double>& L) {
+    A = L;
+    A.makeCompressed();
+    diagonal.resize(A.cols());
+    for (int j = 0; j < A.cols(); ++j) {
+        const int* begin = A.innerIndexPtr() + A.outerIndexPtr()[j];
+        const int* end = A.innerIndexPtr() + A.outerIndexPtr()[j + 1];
+        diagonal[j] = lower_bound(begin, end, j) - A.innerIndexPtr();
+    }
+    analysed = false;
+    factored = false;
+}
+
+bool ImplicitSmoother::step(const Eigen::SparseMatrix<double>& L, const Eigen::SparseMatrix<double>& M, double lambda,
+                            Eigen::MatrixXd& V) {
+    const int nnz = A.nonZeros();
+    const double* l = L.valuePtr();
+    const double* m = M.valuePtr();
+    const bool unchanged = factored && lambda == factored_lambda && equal(l, l + nnz, factored_L.begin()) &&
+                           equal(m, m + M.nonZeros(), factored_M.begin());
+    if (!unchanged) {
+        // Same pattern, so only the values are rewritten.
+        double* a = A.valuePtr();
+        igl::parallel_for(nnz, [&](int k) { a[k] = -lambda * l[k]; }, 10000);
+        for (int j = 0; j < A.cols(); ++j)
+            a[diagonal[j]] += m[j];
+
+        if (iterative())
+            cg.compute(A);
+        else {
+            if (!analysed)
+                llt.analyzePattern(A);
+            analysed = true;
+            llt.factorize(A);
+        }
+        factored_L.assign(l, l + nnz);
+        factored_M.assign(m, m + M.nonZeros());
+        factored_lambda = lambda;
+        factored = (iterative() ? cg.info() : llt.info()) == Eigen::Success;
+        if (!factored) {
+            cerr << "ImplicitSmoother: factorization failed" << endl;
+            return false;
+        }
+    }
+
+    const Eigen::MatrixXd b = M * V;
+    if (!iterative()) {
+        V = llt.solve(b);
+        return true;
+    }
+    cg.setTolerance(tolerance);
+    for (int c = 0; c < 3; ++c) {
+        const Eigen::VectorXd guess = V.col(c);
+        V.col(c) = cg.solveWithGuess(b.col(c), guess);
+        if (cg.info() != Eigen::Success) {
+            cerr << "ImplicitSmoother: conjugate gradients did not converge" << endl;
+            return false;
+        }
+    }
+    return true;
+}
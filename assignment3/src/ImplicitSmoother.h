@@ -0,0 +1,48 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <vector>
+
+// Implicit Laplacian smoothing, solving (M - lambda L) V' = M V per step.
+//
+// M - lambda L has the sparsity pattern of L, which does not change for a
+// given mesh: the symbolic Cholesky analysis runs once per pattern, and step
+// only refills the values of the system and refactors it numerically, and
+// only if lambda, L or M differ from the previous step. Meshes with more
+// vertices than iterative_threshold are solved with preconditioned
+// conjugate gradients instead, warm-started from the current positions.
+class ImplicitSmoother {
+public:
+    // Take the sparsity pattern of L (with its diagonal). Must be called
+    // again when the topology changes.
+    void set_pattern(const Eigen::SparseMatrix<double>& L);
+
+    // Replace V by the solution of (M - lambda L) V' = M V. L must have the
+    // pattern given to set_pattern and M be diagonal, with one stored entry
+    // per column.
+    // Returns false if the factorisation or the iterative solve fails.
+    bool step(const Eigen::SparseMatrix<double>& L, const Eigen::SparseMatrix<double>& M, double lambda,
+              Eigen::MatrixXd& V);
+
+    // Number of vertices above which conjugate gradients are used.
+    int iterative_threshold = 500000;
+    // Relative residual at which conjugate gradients stop.
+    double tolerance = 1e-10;
+
+private:
+    bool iterative() const { return A.rows() > iterative_threshold; }
+
+    Eigen::SparseMatrix<double> A;
+    // Position of the diagonal entry of each column in the value array of A.
+    std::vector<int> diagonal;
+    Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> llt;
+    bool analysed = false;
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper> cg;
+
+    // Inputs of the current factorisation.
+    std::vector<double> factored_L, factored_M;
+    double factored_lambda = 0;
+    bool factored = false;
+};
@@ -0,0 +1,17 @@
+#include "KnnNeighbourhoods.h"
+#include <algorithm>
+#include <igl/knn.h>
+#include <igl/octree.h>
+
+void KnnNeighbourhoods::set_points(const Eigen::MatrixXd& P_) {
+    P = P_;
+    igl::octree(P, point_indices, CH, CN, W);
+    I.resize(0, 0);
+}
+
+const Eigen::MatrixXi& KnnNeighbourhoods::query(int k) {
+    k = std::min<int>(k, P.rows());
+    if (I.cols() < k || I.rows() != P.rows())
+        igl::knn(P, k, point_indices, CH, CN, W, I);
+    return I;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <Eigen/Core>
+#include <vector>
+
+// k nearest neighbours of every vertex, shared by the PCA and quadratic-fit
+// normals and by bilateral smoothing.
+//
+// The octree of the points is built once by set_points, and query runs
+// igl::knn for all points in one parallel batch. The result is kept until
+// the points change, so asking again for the same (or a smaller) k costs
+// nothing.
+class KnnNeighbourhoods {
+public:
+    // Build the octree of P and drop any previous result.
+    void set_points(const Eigen::MatrixXd& P);
+
+    // Indices of the k nearest neighbours of every point, the point itself
+    // included, sorted by distance. The returned array is #P x k' with
+    // k' >= k, of which the first k columns are the answer.
+    const Eigen::MatrixXi& query(int k);
+
+private:
+    Eigen::MatrixXd P;
+    std::vector<std::vector<int>> point_indices;
+    Eigen::Matrix<int, Eigen::Dynamic, 8> CH;
+    Eigen::MatrixXd CN;
+    Eigen::VectorXd W;
+    Eigen::MatrixXi I;
+};
@@ -0,0 +1,66 @@
+#include "LaplacianAssembler.h"
+#include <igl/parallel_for.h>
+
+void LaplacianAssembler::set_topology(const DifferentialGeometryCache& g) {
+    const int n = g.num_vertices();
+
+    // Column i holds the ring of i with i itself inserted in sorted order, so
+    // it starts at ring_start[i] + i.
+    L.resize(n, n);
+    L.resizeNonZeros(g.ring.size() + n);
+    int* outer = L.outerIndexPtr();
+    int* inner = L.innerIndexPtr();
+    diagonal.resize(n);
+    for (int i = 0; i <= n; ++i)
+        outer[i] = g.ring_start[i] + i;
+    igl::parallel_for(n, [&](int i) {
+        int slot = outer[i];
+        bool diagonal_written = false;
+        for (int k = g.ring_start[i]; k < g.ring_start[i + 1]; ++k) {
+            if (!diagonal_written && g.ring[k] > i) {
+                diagonal[i] = slot;
+                inner[slot++] = i;
+                diagonal_written = true;
+            }
+            inner[slot++] = g.ring[k];
+        }
+        if (!diagonal_written) {
+            diagonal[i] = slot;
+            inner[slot] = i;
+        }
+    }, 1000);
+
+    M.resize(n, n);
+    M.resizeNonZeros(n);
+    for (int i = 0; i <= n; ++i)
+        M.outerIndexPtr()[i] = i;
+    for (int i = 0; i < n; ++i)
+        M.innerIndexPtr()[i] = i;
+}
+
+void LaplacianAssembler::assemble(const DifferentialGeometryCache& g, MassMatrixType type) {
+    const int n = g.num_vertices();
+    const int* outer = L.outerIndexPtr();
+    double* values = L.valuePtr();
+    double* masses = M.valuePtr();
+    igl::parallel_for(n, [&](int i) {
+        // Ring entries before the diagonal keep their offset, the others are
+        // shifted by one.
+        double sum = 0;
+        for (int k = g.ring_start[i]; k < g.ring_start[i + 1]; ++k) {
+            const int slot = outer[i] + (k - g.ring_start[i]) + (g.ring[k] > i);
+            values[slot] = g.ring_cotangents[k];
+            sum += g.ring_cotangents[k];
+        }
+        values[diagonal[i]] = -sum;
+
+        if (type == VORONOI)
+            masses[i] = g.voronoi_areas(i);
+        else {
+            double area = 0;
+            for (int k = g.vf_start[i]; k < g.vf_start[i + 1]; ++k)
+                area += g.face_areas(g.vf[k]);
+            masses[i] = area / 3;
+        }
+    }, 1000);
+}
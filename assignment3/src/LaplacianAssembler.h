@@ -0,0 +1,34 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include "DifferentialGeometryCache.h"
+
+// Assembles the cotangent Laplacian and the lumped mass matrix of a mesh
+// directly into compressed storage.
+//
+// The sparsity pattern of L (the one-ring of each vertex plus the diagonal)
+// is derived once from the topology of the cache by set_topology. assemble
+// then only rewrites the value arrays, in parallel over the columns, so
+// reassembling after the vertices moved costs no allocation. L is symmetric,
+// so its column-major storage is also its row-major (CSR) storage.
+class LaplacianAssembler {
+public:
+    enum MassMatrixType { BARYCENTRIC, VORONOI };
+
+    // Build the sparsity patterns of L and M.
+    void set_topology(const DifferentialGeometryCache& geometry);
+
+    // Fill in the values of L and M from the geometry of the cache, which
+    // must have the topology passed to set_topology.
+    void assemble(const DifferentialGeometryCache& geometry, MassMatrixType type = VORONOI);
+
+    // Cotangent Laplacian, L_ij = (cot alpha_ij + cot beta_ij) / 2 and
+    // L_ii = -sum_j L_ij, negative semi-definite like igl::cotmatrix
+    Eigen::SparseMatrix<double> L;
+    // Diagonal lumped mass matrix
+    Eigen::SparseMatrix<double> M;
+
+private:
+    // Position of the diagonal entry of each column in the value array of L.
+    std::vector<int> diagonal;
+};
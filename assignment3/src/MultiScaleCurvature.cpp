@@ -0,0 +1,176 @@
+#include "MultiScaleCurvature.h"
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <igl/parallel_for.h>
+
+using namespace std;
+
+namespace {
+typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+// Sums over a growing neighbourhood of p, in the tangent frame (t1, t2, n) of
+// its initial normal.
+struct Accumulator {
+    Eigen::Vector3d p, t1, t2, normal;
+    // Quadric normal equations, unscaled
+    Matrix6d A;
+    Vector6d rhs;
+    // First and second moments of the offsets from p
+    Eigen::Vector3d sum;
+    Eigen::Matrix3d outer;
+    int count;
+    double radius2;
+
+    Accumulator(const Eigen::MatrixXd& V, const Eigen::MatrixXd& N0, int i) {
+        p = V.row(i).transpose();
+        normal = N0.row(i).transpose();
+        normal.normalize();
+        t1 = normal.unitOrthogonal();
+        t2 = normal.cross(t1);
+        A.setZero();
+        rhs.setZero();
+        sum.setZero();
+        outer.setZero();
+        count = 0;
+        radius2 = 0;
+    }
+
+    void add(const Eigen::MatrixXd& V, int j) {
+        const Eigen::Vector3d d = V.row(j).transpose() - p;
+        const double u = d.dot(t1), v = d.dot(t2), w = d.dot(normal);
+        Vector6d b;
+        b << u * u, u * v, v * v, u, v, 1;
+        A.selfadjointView<Eigen::Lower>().rankUpdate(b);
+        rhs += w * b;
+        sum += d;
+        outer.selfadjointView<Eigen::Lower>().rankUpdate(d);
+        ++count;
+        radius2 = max(radius2, d.squaredNorm());
+    }
+
+    // Curvatures of the current neighbourhood into column s of row i.
+    void evaluate(int i, int s, MultiScaleCurvatures& K) const {
+        const Eigen::Vector3d mean = sum / max(count, 1);
+        const Eigen::Matrix3d covariance =
+            Eigen::Matrix3d(outer.selfadjointView<Eigen::Lower>()) / max(count, 1) - mean * mean.transpose();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen;
+        eigen.computeDirect(covariance, Eigen::EigenvaluesOnly);
+        const double trace = eigen.eigenvalues().sum();
+        K.variation(i, s) = trace > 0 ? max(eigen.eigenvalues()(0), 0.0) / trace : 0;
+
+        // The fit of quadratic_fit, in coordinates divided by the radius:
+        // the basis functions scale by D = diag(r^-2, r^-2, r^-2, r^-1, r^-1, 1)
+        // and the heights by 1 / r.
+        const double scale = radius2 > 0 ? sqrt(radius2) : 1;
+        Vector6d D;
+        D << 1 / (scale * scale), 1 / (scale * scale), 1 / (scale * scale), 1 / scale, 1 / scale, 1;
+        Matrix6d A_scaled = D.asDiagonal() * Matrix6d(A.selfadjointView<Eigen::Lower>()) * D.asDiagonal();
+        Eigen::LDLT<Matrix6d> ldlt(A_scaled);
+        const Vector6d pivots = ldlt.vectorD().cwiseAbs();
+        const Vector6d c = ldlt.solve(D.cwiseProduct(rhs) / scale);
+        if (count < 6 || ldlt.info() != Eigen::Success || pivots.minCoeff() < 1e-10 * pivots.maxCoeff() ||
+            !c.allFinite()) {
+            K.mean(i, s) = K.gaussian(i, s) = K.min(i, s) = K.max(i, s) = 0;
+            return;
+        }
+
+        // Mean and Gaussian curvature from the first and second fundamental
+        // forms of the height field, signed like in quadratic_fit.
+        const double wu = c(3), wv = c(4);
+        const double E = 1 + wu * wu, Fm = wu * wv, G = 1 + wv * wv;
+        const double factor = -1 / (sqrt(1 + wu * wu + wv * wv) * scale);
+        const double L = 2 * c(0) * factor, M = c(1) * factor, N = 2 * c(2) * factor;
+        const double det = E * G - Fm * Fm;
+        const double H = 0.5 * (E * N - 2 * Fm * M + G * L) / det;
+        const double KG = (L * N - M * M) / det;
+        const double discriminant = sqrt(max(H * H - KG, 0.0));
+        K.mean(i, s) = H;
+        K.gaussian(i, s) = KG;
+        K.min(i, s) = H - discriminant;
+        K.max(i, s) = H + discriminant;
+    }
+};
+
+void resize(MultiScaleCurvatures& K, int n, int scales) {
+    K.mean.resize(n, scales);
+    K.gaussian.resize(n, scales);
+    K.min.resize(n, scales);
+    K.max.resize(n, scales);
+    K.variation.resize(n, scales);
+}
+}
+
+void multi_scale_curvature(const Eigen::MatrixXd& V, const Eigen::MatrixXi& I, const std::vector<int>& sizes,
+                           const Eigen::MatrixXd& N0, MultiScaleCurvatures& K) {
+    const int n = V.rows(), scales = sizes.size();
+    resize(K, n, scales);
+    igl::parallel_for(n, [&](int i) {
+        Accumulator accumulator(V, N0, i);
+        int j = 0;
+        for (int s = 0; s < scales; ++s) {
+            for (const int size = min<int>(sizes[s], I.cols()); j < size; ++j)
+                accumulator.add(V, I(i, j));
+            accumulator.evaluate(i, s, K);
+        }
+    }, 1000);
+}
+
+void multi_scale_radius_curvature(const Eigen::MatrixXd& V, const Eigen::MatrixXi& I, const std::vector<double>& radii,
+                                  const Eigen::MatrixXd& N0, MultiScaleCurvatures& K) {
+    const int n = V.rows(), scales = radii.size();
+    resize(K, n, scales);
+    igl::parallel_for(n, [&](int i) {
+        Accumulator accumulator(V, N0, i);
+        int j = 0;
+        for (int s = 0; s < scales; ++s) {
+            const double radius2 = radii[s] * radii[s];
+            for (; j < I.cols() && (V.row(I(i, j)) - V.row(i)).squaredNorm() <= radius2; ++j)
+                accumulator.add(V, I(i, j));
+            accumulator.evaluate(i, s, K);
+        }
+    }, 1000);
+}
+
+void multi_scale_ring_curvature(const Eigen::MatrixXd& V, const DifferentialGeometryCache& g, int rings,
+                                const Eigen::MatrixXd& N0, MultiScaleCurvatures& K) {
+    const int n = V.rows();
+    rings = max(rings, 0);
+    resize(K, n, rings);
+    igl::parallel_for(n, [&](int i) {
+        // Breadth-first order of the vertices within rings rings; the marks
+        // are cleared after every vertex, so they stay all false between
+        // vertices and are only allocated once per thread.
+        thread_local vector<char> visited;
+        thread_local vector<int> order;
+        if (visited.size() < (size_t)n)
+            visited.assign(n, false);
+        order.assign(1, i);
+        visited[i] = true;
+
+        Accumulator accumulator(V, N0, i);
+        accumulator.add(V, i);
+        size_t ring_begin = 0;
+        for (int s = 0; s < rings; ++s) {
+            const size_t ring_end = order.size();
+            for (size_t k = ring_begin; k < ring_end; ++k) {
+                const int v = order[k];
+                for (int r = g.ring_start[v]; r < g.ring_start[v + 1]; ++r) {
+                    const int j = g.ring[r];
+                    if (!visited[j]) {
+                        visited[j] = true;
+                        order.push_back(j);
+                        accumulator.add(V, j);
+                    }
+                }
+            }
+            ring_begin = ring_end;
+            accumulator.evaluate(i, s, K);
+        }
+        for (const int v : order)
+            visited[v] = false;
+    }, 1000);
+}
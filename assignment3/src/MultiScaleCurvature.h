@@ -0,0 +1,66 @@
+#pragma once
+#include <Eigen/Core>
+#include <vector>
+#include "DifferentialGeometryCache.h"
+
+// Curvatures of every vertex at several nested neighbourhood sizes, one
+// column per scale.
+struct MultiScaleCurvatures {
+    // Mean, Gaussian, minimal and maximal principal curvature of the quadric
+    // fitted at each scale (see QuadraticFit.h), #V x scales
+    Eigen::MatrixXd mean, gaussian, min, max;
+    // Surface variation l0 / (l0 + l1 + l2) of the neighbourhood covariance
+    // with eigenvalues l0 <= l1 <= l2 at each scale (Pauly et al. 2002),
+    // #V x scales
+    Eigen::MatrixXd variation;
+};
+
+// Multi-scale curvature over growing neighbourhoods in one traversal.
+//
+// The neighbours of a vertex are visited once, from the nearest outwards.
+// The quadric normal equations of the height field in the frame of the
+// initial normal, and the covariance of the points, are sums over the
+// neighbours, so each scale adds its new points to the sums of the previous
+// one and only solves the 6x6 system and the 3x3 eigenproblem. The sums are
+// kept unscaled and rescaled to the radius of each scale before the solve,
+// which gives the same fit as quadratic_fit on that neighbourhood.
+//
+// Inputs:
+//   V  #V x3 vertex positions
+//   I  #V x k' neighbour indices sorted by distance, the vertex itself
+//      first, e.g. from KnnNeighbourhoods
+//   sizes  increasing neighbourhood sizes, one per scale, at most k'
+//   N0  #V x3 initial normals, which also orient the result
+// Outputs:
+//   K  curvatures, with sizes.size() columns
+void multi_scale_curvature(const Eigen::MatrixXd& V, const Eigen::MatrixXi& I, const std::vector<int>& sizes,
+                           const Eigen::MatrixXd& N0, MultiScaleCurvatures& K);
+
+// Same over the neighbours within increasing radii, e.g. a fraction of the
+// bounding box diagonal, so that the scales do not depend on the sampling
+// density. Each scale takes the leading neighbours of I up to the first one
+// farther than its radius; a neighbourhood reaching beyond the k' neighbours
+// of I is truncated to them.
+//
+// Inputs:
+//   V  #V x3 vertex positions
+//   I  #V x k' neighbour indices sorted by distance, the vertex itself first
+//   radii  increasing radii, one per scale
+//   N0  #V x3 initial normals
+// Outputs:
+//   K  curvatures, with radii.size() columns
+void multi_scale_radius_curvature(const Eigen::MatrixXd& V, const Eigen::MatrixXi& I, const std::vector<double>& radii,
+                                  const Eigen::MatrixXd& N0, MultiScaleCurvatures& K);
+
+// Same over the topological neighbourhoods of 1 to rings rings, found by a
+// breadth-first walk of the one-rings of the cache.
+//
+// Inputs:
+//   V  #V x3 vertex positions
+//   geometry  geometry cache of the mesh, only its topology is used
+//   rings  number of scales
+//   N0  #V x3 initial normals
+// Outputs:
+//   K  curvatures, with rings columns
+void multi_scale_ring_curvature(const Eigen::MatrixXd& V, const DifferentialGeometryCache& geometry, int rings,
+                                const Eigen::MatrixXd& N0, MultiScaleCurvatures& K);
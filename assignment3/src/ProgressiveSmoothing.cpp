@@ -0,0 +1,38 @@
+#include "ProgressiveSmoothing.h"
+
+void ProgressiveSmoothing::start(const Eigen::MatrixXd& V, int iterations, Step step) {
+    cancel();
+    for (auto& buffer : buffers)
+        buffer.resize(V.rows(), V.cols());
+    back = 0;
+    middle = 1;
+    front = 2;
+    stop = false;
+    busy = true;
+    done = 0;
+    worker = std::thread([this, V, iterations, step]() {
+        Eigen::MatrixXd current = V;
+        for (int it = 0; it < iterations && !stop; ++it) {
+            step(current);
+            buffers[back] = current;
+            back = middle.exchange(back | Fresh) & ~Fresh;
+            ++done;
+        }
+        busy = false;
+    });
+}
+
+void ProgressiveSmoothing::cancel() {
+    stop = true;
+    if (worker.joinable())
+        worker.join();
+    busy = false;
+}
+
+bool ProgressiveSmoothing::poll(Eigen::MatrixXd& V) {
+    if (!(middle.load() & Fresh))
+        return false;
+    front = middle.exchange(front) & ~Fresh;
+    V = buffers[front];
+    return true;
+}
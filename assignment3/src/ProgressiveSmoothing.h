@@ -0,0 +1,53 @@
+#pragma once
+#include <Eigen/Core>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Runs smoothing iterations on a worker thread and hands every intermediate
+// result to the UI thread without locks.
+//
+// The worker smooths its own copy of the vertices and, after every
+// iteration, copies it into a back buffer and swaps that with the shared
+// middle buffer in one atomic exchange (triple buffering). poll, called from
+// the UI thread e.g. in callback_pre_draw, swaps the middle buffer with its
+// front buffer if a newer result was published, so neither side ever waits
+// or reads a buffer that is being written.
+class ProgressiveSmoothing {
+public:
+    // One smoothing iteration applied to V in place.
+    using Step = std::function<void(Eigen::MatrixXd& V)>;
+
+    ~ProgressiveSmoothing() { cancel(); }
+
+    // Cancel any running smoothing, then run the given number of iterations
+    // of step, starting from V, in the background.
+    void start(const Eigen::MatrixXd& V, int iterations, Step step);
+
+    // Ask the worker to stop after the current iteration and wait for it.
+    // The last published result can still be polled.
+    void cancel();
+
+    // Whether the worker is still iterating.
+    bool running() const { return busy; }
+
+    // Number of iterations published so far.
+    int iterations_done() const { return done; }
+
+    // If a result newer than the last poll was published, copy it to V and
+    // return true.
+    bool poll(Eigen::MatrixXd& V);
+
+private:
+    static const int Fresh = 4;
+
+    Eigen::MatrixXd buffers[3];
+    // Index of the middle buffer, with the Fresh bit set if it holds a
+    // result that was not polled yet.
+    std::atomic<int> middle{1};
+    int back = 0, front = 2;
+
+    std::thread worker;
+    std::atomic<bool> stop{false}, busy{false};
+    std::atomic<int> done{0};
+};
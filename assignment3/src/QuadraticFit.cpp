@@ -0,0 +1,82 @@
+#include "QuadraticFit.h"
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+#include <Eigen/Geometry>
+#include <cmath>
+#include <igl/parallel_for.h>
+
+using namespace std;
+
+void quadratic_fit(const Eigen::MatrixXd& V, const Eigen::MatrixXi& I, int k, const Eigen::MatrixXd& N0,
+                   Eigen::MatrixXd& N, Eigen::VectorXd& K_min, Eigen::VectorXd& K_max,
+                   Eigen::MatrixXd& PD_min, Eigen::MatrixXd& PD_max) {
+    typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+    typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+    const int n = V.rows();
+    k = min<int>(k, I.cols());
+    N.resize(n, 3);
+    K_min.resize(n);
+    K_max.resize(n);
+    PD_min.resize(n, 3);
+    PD_max.resize(n, 3);
+
+    igl::parallel_for(n, [&](int i) {
+        // Tangent frame of the initial normal.
+        const Eigen::Vector3d p = V.row(i).transpose();
+        Eigen::Vector3d normal = N0.row(i).transpose();
+        normal.normalize();
+        const Eigen::Vector3d t1 = normal.unitOrthogonal();
+        const Eigen::Vector3d t2 = normal.cross(t1);
+
+        // Scale the coordinates by the neighbourhood size to keep the normal
+        // equations well conditioned.
+        double scale = 0;
+        for (int j = 0; j < k; ++j)
+            scale = max(scale, (V.row(I(i, j)).transpose() - p).squaredNorm());
+        scale = scale > 0 ? sqrt(scale) : 1;
+
+        Matrix6d A = Matrix6d::Zero();
+        Vector6d rhs = Vector6d::Zero();
+        for (int j = 0; j < k; ++j) {
+            const Eigen::Vector3d d = (V.row(I(i, j)).transpose() - p) / scale;
+            const double u = d.dot(t1), v = d.dot(t2), w = d.dot(normal);
+            Vector6d b;
+            b << u * u, u * v, v * v, u, v, 1;
+            A.selfadjointView<Eigen::Lower>().rankUpdate(b);
+            rhs += w * b;
+        }
+        // Neighbours that do not determine a quadric, e.g. all on one
+        // circle, give (nearly) singular normal equations; keep the initial
+        // frame there.
+        Eigen::LDLT<Matrix6d> ldlt(A);
+        const Vector6d pivots = ldlt.vectorD().cwiseAbs();
+        const Vector6d c = ldlt.solve(rhs);
+        if (k < 6 || ldlt.info() != Eigen::Success || pivots.minCoeff() < 1e-10 * pivots.maxCoeff() ||
+            !c.allFinite()) {
+            N.row(i) = normal.transpose();
+            K_min(i) = K_max(i) = 0;
+            PD_min.row(i) = t1.transpose();
+            PD_max.row(i) = t2.transpose();
+            return;
+        }
+
+        // Height field x(u, v) = p + u t1 + v t2 + w(u, v) n, in the scaled
+        // coordinates, at the origin.
+        const double wu = c(3), wv = c(4);
+        const Eigen::Vector3d xu = t1 + wu * normal, xv = t2 + wv * normal;
+        N.row(i) = xu.cross(xv).normalized().transpose();
+
+        // Shape operator I^-1 II, with the sign chosen so that a cap bulging
+        // towards the normal has positive curvature.
+        Eigen::Matrix2d first, second;
+        first << 1 + wu * wu, wu * wv, wu * wv, 1 + wv * wv;
+        second << 2 * c(0), c(1), c(1), 2 * c(2);
+        second *= -1 / (sqrt(1 + wu * wu + wv * wv) * scale);
+        Eigen::GeneralizedSelfAdjointEigenSolver<Eigen::Matrix2d> eigen(second, first);
+        K_min(i) = eigen.eigenvalues()(0);
+        K_max(i) = eigen.eigenvalues()(1);
+        PD_min.row(i) = (eigen.eigenvectors()(0, 0) * xu + eigen.eigenvectors()(1, 0) * xv).normalized().transpose();
+        PD_max.row(i) = (eigen.eigenvectors()(0, 1) * xu + eigen.eigenvectors()(1, 1) * xv).normalized().transpose();
+    }, 1000);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <Eigen/Core>
+
+// Per-vertex quadratic surface fitting.
+//
+// In the tangent frame (t1, t2, n) of an initial normal n at vertex p, the
+// neighbours are fitted in the least squares sense by the height field
+//
+//   w = a u^2 + b uv + c v^2 + d u + e v + f.
+//
+// The 6x6 normal equations are fixed-size and solved with a stack-only LDLT,
+// so the parallel loop over the vertices does not allocate. The normal of the
+// height field at the origin is the fitted normal, and its shape operator
+// gives the principal curvatures and directions from the same fit.
+//
+// Inputs:
+//   V  #V x3 vertex positions
+//   I  #V x k' neighbour indices, e.g. from KnnNeighbourhoods
+//   k  number of columns of I to use (at least 6)
+//   N0  #V x3 initial normals, which also orient the result
+// Outputs:
+//   N  #V x3 fitted unit normals, oriented like N0
+//   K_min, K_max  #V principal curvatures, positive where the surface is
+//                 convex with respect to N
+//   PD_min, PD_max  #V x3 unit principal directions
+void quadratic_fit(const Eigen::MatrixXd& V, const Eigen::MatrixXi& I, int k, const Eigen::MatrixXd& N0,
+                   Eigen::MatrixXd& N, Eigen::VectorXd& K_min, Eigen::VectorXd& K_max,
+                   Eigen::MatrixXd& PD_min, Eigen::MatrixXd& PD_max);
@@ -0,0 +1,110 @@
+#include "SpectralSmoother.h"
+#include <Eigen/Eigenvalues>
+#include <Eigen/SparseCholesky>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+bool SpectralSmoother::compute(const Eigen::SparseMatrix<double>& L, const Eigen::SparseMatrix<double>& M,
+                               const Eigen::MatrixXd& V, int k) {
+    const int n = V.rows();
+    k = max(1, min(k, n));
+    basis.resize(0, 0);
+    mu.resize(0);
+
+    // Shift below the spectrum of interest but large enough for sigma M - L
+    // to be safely positive definite; the spectrum scales like -L_ii / M_ii.
+    const Eigen::VectorXd m = M.diagonal();
+    const double sigma = 1e-6 * (-L.diagonal().array() / m.array()).mean();
+    const Eigen::SparseMatrix<double> A = sigma * M - L;
+    Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> llt(A);
+    if (llt.info() != Eigen::Success) {
+        cerr << "SpectralSmoother: factorization failed" << endl;
+        return false;
+    }
+
+    // Lanczos on A^-1 M, which is self-adjoint in the M inner product, with
+    // full reorthogonalisation. Its largest eigenvalues theta = 1 / (mu + sigma)
+    // converge first. The Krylov space is extended until the k largest Ritz
+    // pairs have converged, i.e. the M-norm |beta_j y_j| of their Lanczos
+    // residuals is below tolerance * theta, or until maxSteps.
+    const double tolerance = 1e-8;
+    const int maxSteps = min(n, 6 * k + 60);
+    int steps = min(n, 2 * k + 20);
+    Eigen::MatrixXd Q(n, steps + 1), MQ(n, steps + 1);
+    Eigen::VectorXd alpha(maxSteps), beta(maxSteps);
+    Eigen::VectorXd q = Eigen::VectorXd::Ones(n) + 0.1 * Eigen::VectorXd::Random(n);
+    q /= sqrt(q.dot(m.cwiseProduct(q)));
+    Q.col(0) = q;
+    MQ.col(0) = m.cwiseProduct(q);
+    int size = 0;
+    bool invariant = false;
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen;
+    while (true) {
+        for (; size < steps; ++size) {
+            const int j = size;
+            Eigen::VectorXd w = llt.solve(MQ.col(j));
+            alpha(j) = MQ.col(j).dot(w);
+            for (int pass = 0; pass < 2; ++pass)
+                w -= Q.leftCols(j + 1) * (MQ.leftCols(j + 1).transpose() * w);
+            const Eigen::VectorXd Mw = m.cwiseProduct(w);
+            beta(j) = sqrt(max(w.dot(Mw), 0.0));
+            if (beta(j) < 1e-12 * abs(alpha(j))) {
+                // Invariant subspace found, the Ritz pairs are exact.
+                size = j + 1;
+                invariant = true;
+                break;
+            }
+            Q.col(j + 1) = w / beta(j);
+            MQ.col(j + 1) = Mw / beta(j);
+        }
+
+        Eigen::MatrixXd T = Eigen::MatrixXd::Zero(size, size);
+        for (int j = 0; j < size; ++j) {
+            T(j, j) = alpha(j);
+            if (j + 1 < size)
+                T(j, j + 1) = T(j + 1, j) = beta(j);
+        }
+        eigen.compute(T);
+        const int wanted = min(k, size);
+        const Eigen::VectorXd theta = eigen.eigenvalues().tail(wanted);
+        const Eigen::VectorXd last = eigen.eigenvectors().row(size - 1).tail(wanted).transpose();
+        const bool converged =
+            ((beta(size - 1) * last).cwiseAbs().array() <= tolerance * theta.cwiseAbs().array()).all();
+        if (invariant || converged || size >= maxSteps)
+            break;
+        steps = min(maxSteps, steps + k + 20);
+        Q.conservativeResize(n, steps + 1);
+        MQ.conservativeResize(n, steps + 1);
+    }
+
+    // Ritz pairs of the k largest eigenvalues, in increasing order of mu.
+    k = min(k, size);
+    const Eigen::MatrixXd Y = eigen.eigenvectors().rightCols(k).rowwise().reverse();
+    mu = (1 / eigen.eigenvalues().tail(k).reverse().array() - sigma).matrix();
+    basis.noalias() = Q.leftCols(size) * Y;
+
+    // Keep the pairs up to the first one whose residual on the original
+    // problem, |-L phi - mu M phi| <= tolerance (|mu| + sigma) |M phi|, is
+    // too large, so the basis stays the lowest frequencies.
+    const Eigen::MatrixXd Mbasis = m.asDiagonal() * basis;
+    const Eigen::MatrixXd residuals = -(L * basis) - Mbasis * mu.asDiagonal();
+    int converged = 0;
+    while (converged < k && residuals.col(converged).norm() <=
+                                sqrt(tolerance) * (abs(mu(converged)) + sigma) * Mbasis.col(converged).norm())
+        ++converged;
+    if (converged < k) {
+        cerr << "SpectralSmoother: " << converged << " of " << k << " eigenpairs converged after " << size
+             << " Lanczos steps" << endl;
+        basis.conservativeResize(n, converged);
+        mu.conservativeResize(converged);
+    }
+    coefficients.noalias() = basis.transpose() * (m.asDiagonal() * V);
+    return converged > 0;
+}
+
+void SpectralSmoother::reconstruct(const Eigen::VectorXd& gains, Eigen::MatrixXd& V) const {
+    V.noalias() = basis * (gains.asDiagonal() * coefficients);
+}
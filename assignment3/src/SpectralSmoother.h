@@ -0,0 +1,42 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+// Spectral smoothing with the low-frequency eigenbasis of the Laplacian.
+//
+// compute solves -L phi = mu M phi for the k smallest mu once, with a
+// shift-invert Lanczos iteration that reuses one sparse Cholesky
+// factorisation of sigma M - L, and stores the coefficients C = Phi^T M V of
+// the vertex positions. Any low-pass filter is then a k x3 rescale of C and a
+// single product with the basis, V' = Phi diag(gains) C, which is fast enough
+// to follow a slider.
+class SpectralSmoother {
+public:
+    // Compute the basis and the coefficients of V.
+    //
+    // Inputs:
+    //   L  #V x #V cotangent Laplacian (negative semi-definite)
+    //   M  #V x #V diagonal mass matrix
+    //   V  #V x3 vertex positions
+    //   k  number of eigenvectors
+    // Returns false if the factorisation fails or no eigenpair converges. If
+    // only some of the k pairs converge, the basis keeps the converged lowest
+    // frequencies and size() is smaller than k.
+    bool compute(const Eigen::SparseMatrix<double>& L, const Eigen::SparseMatrix<double>& M, const Eigen::MatrixXd& V,
+                 int k);
+
+    // Reconstruct V' = Phi diag(gains) C, with one gain per eigenvector.
+    void reconstruct(const Eigen::VectorXd& gains, Eigen::MatrixXd& V) const;
+
+    // Number of eigenvectors, 0 before compute.
+    int size() const { return basis.cols(); }
+    // Eigenvalues mu, increasing.
+    const Eigen::VectorXd& eigenvalues() const { return mu; }
+
+private:
+    // M-orthonormal eigenvectors, #V x k
+    Eigen::MatrixXd basis;
+    Eigen::VectorXd mu;
+    // Coefficients of V in the basis, k x3
+    Eigen::MatrixXd coefficients;
+};
@@ -1,7 +1,13 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <igl/read_triangle_mesh.h>
 #include <imgui.h>
+#include <mesh_reordering.h>
 #include <viewer_proxy.h>
 
 #include <igl/jet.h>
@@ -15,7 +21,22 @@
 #include <igl/barycenter.h>
 #include <igl/knn.h>
 #include <igl/octree.h>
+#include <igl/parallel_for.h>
+#include <igl/avg_edge_length.h>
+#include <igl/per_vertex_normals.h>
 /*** insert any libigl headers here ***/
+#include <Eigen/Eigenvalues>
+#include "BilateralDenoiser.h"
+#include "Curvature.h"
+#include "DifferentialGeometryCache.h"
+#include "ExplicitSmoother.h"
+#include "ImplicitSmoother.h"
+#include "KnnNeighbourhoods.h"
+#include "LaplacianAssembler.h"
+#include "MultiScaleCurvature.h"
+#include "ProgressiveSmoothing.h"
+#include "QuadraticFit.h"
+#include "SpectralSmoother.h"
 
 using namespace std;
 using Viewer = ViewerProxy;
@@ -49,6 +70,8 @@ Eigen::VectorXd K_Gaussian;
 Eigen::VectorXd K_min_principal;
 // Per-vertex maximal principal curvature, #Vx3
 Eigen::VectorXd K_max_principal;
+// Per-vertex minimal and maximal principal curvature directions, #Vx3
+Eigen::MatrixXd PD_min, PD_max;
 // Per-vertex color array, #Vx3
 Eigen::MatrixXd colors_per_vertex;
 
@@ -58,15 +81,313 @@ Eigen::MatrixXd V_expLap;
 Eigen::MatrixXd V_impLap;
 // Bilateral smoothed vertex array, #Vx3
 Eigen::MatrixXd V_bilateral;
+// Spectrally smoothed vertex array, #Vx3
+Eigen::MatrixXd V_spectral;
+
+// One-rings, cotangent weights, areas and angles of (V, F), built after
+// loading the mesh. Call geometry.invalidate() after modifying V.
+DifferentialGeometryCache geometry;
+
+// Cotangent Laplacian and mass matrix of (V, F), pattern built after loading.
+LaplacianAssembler laplacian;
+
+// Explicit smoothing with the normalised cotangent weights of (V, F).
+ExplicitSmoother explicitSmoother;
+
+// Parameter: step size of explicit smoothing, in (0, 1]
+double explicitLambda = 0.5;
+
+// Parameter: number of explicit smoothing iterations per key press
+int explicitIterations = 10;
+
+// Geometry and operators of the implicitly smoothed mesh V_impLap,
+// reassembled before every smoothing step.
+DifferentialGeometryCache impLapGeometry;
+LaplacianAssembler impLapOperators;
+ImplicitSmoother implicitSmoother;
+
+// k nearest neighbours of the vertices of V, octree built after loading.
+KnnNeighbourhoods neighbourhoods;
+
+// Parameter: number of nearest neighbours used by PCA and quadratic fitting
+int kNearest = 10;
+
+// Parameter: vertex and face order applied after loading, for the locality
+// of the one-ring walks and sparse products, see mesh_reordering.h
+MeshOrdering meshOrdering = MESH_ORDER_MORTON;
+
+// Maps the loaded vertices and faces to their order in the file.
+MeshPermutation meshPermutation;
+
+// Curvatures of (V, F), see curvatureCache().
+Curvatures curvatures;
+bool curvaturesValid = false;
+
+// Parameter: take the principal curvatures (keys 8 and 9) from the quadratic
+// fit instead of the curvature engine
+bool principalFromQuadraticFit = false;
+
+// Curvatures of (V, F) over curvatureScales nested neighbourhoods, see
+// multiScaleCurvature().
+MultiScaleCurvatures multiScale;
+
+// Parameter: neighbourhood of the multi-scale scale s = 1, 2, ...: s rings,
+// the s * kNearest nearest neighbours, or the neighbours within s *
+// curvatureRadius
+int curvatureScaleMode = 0;
+const char* curvatureScaleModes[] = {"Rings", "Nearest neighbours", "Radii"};
+
+// Parameter: number of multi-scale neighbourhoods
+int curvatureScales = 4;
+
+// Parameter: radius of the smallest radius scale, relative to the bounding box
+// diagonal
+double curvatureRadius = 0.02;
+
+// Parameter: scale of the mean curvature shown by key 'M'
+int curvatureScale = 1;
+
+// Parameter: number of implicit smoothing steps per key press
+int implicitIterations = 1;
+
+// Parameter: time step of implicit smoothing, relative to the average vertex
+// area so that it does not depend on the scale of the mesh
+double implicitTimeStep = 1;
+
+// Bilateral denoising of V_bilateral, neighbourhoods gathered on first use.
+BilateralDenoiser bilateralDenoiser;
+
+// Parameter: spatial standard deviation of bilateral denoising, in units of
+// the average edge length; neighbourhoods have twice this radius
+double bilateralSigma = 1;
+
+// Parameter: number of bilateral denoising iterations per key press
+int bilateralIterations = 3;
+
+// Low-frequency eigenbasis of the cotangent Laplacian of (V, F), computed the
+// first time key 'S' is pressed after loading.
+SpectralSmoother spectralSmoother;
+
+// Parameter: number of eigenvectors computed for spectral smoothing
+int spectralBasisSize = 100;
+
+// Parameter: number of eigenvectors kept by the spectral low-pass filter
+int spectralFrequencies = 20;
+
+// Smoothing run in the background, and the vertex array it updates.
+ProgressiveSmoothing progressive;
+Eigen::MatrixXd* progressiveTarget = nullptr;
+
+// Parameter: run the smoothing keys (E, D, B) in the background and show every
+// iteration as it completes
+bool progressiveSmoothing = false;
+
+// Returns the geometry cache, recomputing it if V has changed since.
+const DifferentialGeometryCache& geometryCache() {
+    if (!geometry.valid())
+        geometry.update(V);
+    return geometry;
+}
+
+// Per-vertex normals as the sum of the normals of the incident faces,
+// optionally weighted by the face areas.
+void faceAveragedNormals(bool areaWeighted, Eigen::MatrixXd& N) {
+    const DifferentialGeometryCache& g = geometryCache();
+    N.setZero(V.rows(), 3);
+    igl::parallel_for(V.rows(), [&](int i) {
+        for (int k = g.vf_start[i]; k < g.vf_start[i + 1]; ++k) {
+            const int f = g.vf[k];
+            N.row(i) += (areaWeighted ? g.face_areas(f) : 1.0) * g.face_normals.row(f);
+        }
+    }, 1000);
+}
+
+// Discrete Laplace-Beltrami operator applied to the vertex positions,
+// (1/A_i) sum_j (cot alpha_ij + cot beta_ij)/2 (v_j - v_i), which equals
+// -2 H n at vertex i. #Vx3
+void laplaceBeltramiOfPositions(Eigen::MatrixXd& HN) {
+    laplacian.assemble(geometryCache(), LaplacianAssembler::VORONOI);
+    HN = laplacian.L * V;
+    const Eigen::VectorXd& areas = geometry.voronoi_areas;
+    for (int i = 0; i < HN.rows(); ++i)
+        if (areas(i) > 0)
+            HN.row(i) /= areas(i);
+}
+
+// One step of implicit smoothing of X, solving (M - lambda L) X' = M X with
+// L and M reassembled on the current X and lambda = timeStep times the mean
+// vertex area. The symbolic factorization is shared by all steps, see
+// ImplicitSmoother.h.
+void implicitSmoothingStep(Eigen::MatrixXd& X, double timeStep) {
+    impLapGeometry.update(X);
+    impLapOperators.assemble(impLapGeometry, LaplacianAssembler::BARYCENTRIC);
+    const Eigen::SparseMatrix<double>& M = impLapOperators.M;
+    const double lambda = timeStep * M.diagonal().mean();
+    implicitSmoother.step(impLapOperators.L, M, lambda, X);
+}
+
+// Stop the background smoothing, keeping and showing its latest result.
+void stopProgressiveSmoothing(Viewer& viewer) {
+    progressive.cancel();
+    if (progressiveTarget && progressive.poll(*progressiveTarget)) {
+        viewer.data().set_vertices(*progressiveTarget);
+        viewer.data().compute_normals();
+    }
+    progressiveTarget = nullptr;
+    viewer.core().is_animating = false;
+}
+
+// Run iterations of step on target in the background. The viewer redraws
+// continuously and picks up each result in callback_pre_draw.
+void startProgressiveSmoothing(Viewer& viewer, Eigen::MatrixXd& target, int iterations,
+                               ProgressiveSmoothing::Step step) {
+    progressive.start(target, iterations, step);
+    progressiveTarget = &target;
+    viewer.core().is_animating = true;
+}
+
+// Show the latest result of the background smoothing, if any.
+bool callback_pre_draw(Viewer& viewer) {
+    if (!progressiveTarget)
+        return false;
+    const bool running = progressive.running();
+    if (progressive.poll(*progressiveTarget)) {
+        viewer.data().set_vertices(*progressiveTarget);
+        viewer.data().compute_normals();
+    }
+    else if (!running) {
+        progressiveTarget = nullptr;
+        viewer.core().is_animating = false;
+    }
+    return false;
+}
+
+// Mean-curvature normals, oriented like the area-weighted normals. Where the
+// mean curvature vanishes the area-weighted normal is used instead.
+void meanCurvatureNormals(Eigen::MatrixXd& N) {
+    Eigen::MatrixXd N_reference;
+    faceAveragedNormals(true, N_reference);
+    laplaceBeltramiOfPositions(N);
+    for (int i = 0; i < N.rows(); ++i) {
+        if (N.row(i).squaredNorm() < 1e-20)
+            N.row(i) = N_reference.row(i);
+        else if (N.row(i).dot(N_reference.row(i)) < 0)
+            N.row(i) = -N.row(i);
+    }
+}
+
+// PCA normals: direction of least variance of the k nearest neighbours,
+// oriented like the area-weighted normals.
+void pcaNormals(Eigen::MatrixXd& N) {
+    const Eigen::MatrixXi& I = neighbourhoods.query(kNearest);
+    const int k = std::min<int>(kNearest, I.cols());
+    Eigen::MatrixXd N_reference;
+    faceAveragedNormals(true, N_reference);
+    N.resize(V.rows(), 3);
+    igl::parallel_for(V.rows(), [&](int i) {
+        Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+        for (int j = 0; j < k; ++j)
+            mean += V.row(I(i, j)).transpose();
+        mean /= k;
+        Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+        for (int j = 0; j < k; ++j) {
+            const Eigen::Vector3d d = V.row(I(i, j)).transpose() - mean;
+            covariance += d * d.transpose();
+        }
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen(covariance);
+        Eigen::RowVector3d normal = eigen.eigenvectors().col(0).transpose();
+        N.row(i) = normal.dot(N_reference.row(i)) < 0 ? Eigen::RowVector3d(-normal) : normal;
+    }, 1000);
+}
+
+// Quadratic fit over the k nearest neighbours in the frame of the
+// area-weighted normals, see QuadraticFit.h. The fitted normals and the
+// principal curvatures and directions all come from the same fit.
+void quadraticFit() {
+    Eigen::MatrixXd N_reference;
+    faceAveragedNormals(true, N_reference);
+    quadratic_fit(V, neighbourhoods.query(kNearest), kNearest, N_reference, N_quadraticFit,
+                  K_min_principal, K_max_principal, PD_min, PD_max);
+}
+
+// All curvatures of (V, F) in one pass over the cached geometry, computed on
+// first use after loading so that switching between keys 6 to 9 is free.
+const Curvatures& curvatureCache() {
+    if (!curvaturesValid || !geometry.valid()) {
+        const DifferentialGeometryCache& g = geometryCache();
+        Eigen::MatrixXd N_reference;
+        faceAveragedNormals(true, N_reference);
+        N_reference.rowwise().normalize();
+        compute_curvatures(V, g, N_reference, curvatures);
+        curvaturesValid = true;
+    }
+    return curvatures;
+}
+
+// Principal curvatures and directions for keys 8 and 9, from the curvature
+// engine or from the quadratic fit.
+void principalCurvatures() {
+    if (principalFromQuadraticFit) {
+        quadraticFit();
+        return;
+    }
+    const Curvatures& K = curvatureCache();
+    K_min_principal = K.min;
+    K_max_principal = K.max;
+    PD_min = K.dir_min;
+    PD_max = K.dir_max;
+}
+
+// Mean curvature of (V, F) at all scales in one pass, computed again only
+// after loading or when the scales change. The nearest neighbour and radius
+// scales share one kNN query of curvatureScales * kNearest neighbours, which
+// also bounds the largest radius neighbourhood.
+void multiScaleCurvature() {
+    if (multiScale.mean.rows() != V.rows() || multiScale.mean.cols() != curvatureScales) {
+        Eigen::MatrixXd N_reference;
+        faceAveragedNormals(true, N_reference);
+        if (curvatureScaleMode == 0) {
+            multi_scale_ring_curvature(V, geometry, curvatureScales, N_reference, multiScale);
+        } else {
+            const Eigen::MatrixXi& I = neighbourhoods.query(curvatureScales * kNearest);
+            if (curvatureScaleMode == 1) {
+                std::vector<int> sizes(curvatureScales);
+                for (int s = 0; s < curvatureScales; ++s)
+                    sizes[s] = (s + 1) * kNearest;
+                multi_scale_curvature(V, I, sizes, N_reference, multiScale);
+            } else {
+                const double diagonal = (V.colwise().maxCoeff() - V.colwise().minCoeff()).norm();
+                std::vector<double> radii(curvatureScales);
+                for (int s = 0; s < curvatureScales; ++s)
+                    radii[s] = (s + 1) * curvatureRadius * diagonal;
+                multi_scale_radius_curvature(V, I, radii, N_reference, multiScale);
+            }
+        }
+    }
+    curvatureScale = std::min(std::max(curvatureScale, 1), curvatureScales);
+    K_mean = multiScale.mean.col(curvatureScale - 1);
+}
+
+// Spectral smoothing: V reconstructed from its first spectralFrequencies
+// eigenvectors. Only the reconstruction runs once the basis exists.
+void spectralSmoothing() {
+    if (spectralSmoother.size() == 0 && !spectralSmoother.compute(laplacian.L, laplacian.M, V, spectralBasisSize)) {
+        V_spectral = V;
+        return;
+    }
+    Eigen::VectorXd gains = Eigen::VectorXd::Zero(spectralSmoother.size());
+    gains.head(std::min<int>(std::max(spectralFrequencies, 1), gains.size())).setOnes();
+    spectralSmoother.reconstruct(gains, V_spectral);
+}
 
 bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
+    // The background smoothing shares the operators used below
+    stopProgressiveSmoothing(viewer);
+
     if (key == '1') {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
-        // Add your code for computing uniform vertex normals here:
-        // store in N_uniform
-
-        // Use igl::per_vertex_normals to orient your normals consistently (i.e. to choose consistent signs for the normals).
+        faceAveragedNormals(false, N_uniform);
 
         // Set the viewer normals.
         N_uniform.rowwise().normalize();
@@ -76,10 +397,7 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
     if (key == '2') {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
-        // Add your code for computing area-weighted vertex normals here:
-        // store in N_area
-
-        // Use igl::per_vertex_normals to orient your normals consistently (i.e. to choose consistent signs for the normals).
+        faceAveragedNormals(true, N_area);
 
         // Set the viewer normals.
         N_area.rowwise().normalize();
@@ -89,11 +407,7 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
     if (key == '3') {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
-        // Add your code for computing mean-curvature vertex normals here:
-        // store in N_meanCurvature
-
-        // Use igl::per_vertex_normals to orient your normals consistently (i.e. to choose consistent signs for the normals).
-    
+        meanCurvatureNormals(N_meanCurvature);
         // Set the viewer normals.
         N_meanCurvature.rowwise().normalize();
         viewer.data().set_normals(N_meanCurvature);
@@ -102,10 +416,7 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
     if (key == '4') {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
-        // Add your code for computing PCA vertex normals here:
-        // store in N_PCA
-
-        // Use igl::per_vertex_normals to orient your normals consistently (i.e. to choose consistent signs for the normals).
+        pcaNormals(N_PCA);
 
         // Set the viewer normals.
         N_PCA.rowwise().normalize();
@@ -115,10 +426,7 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
     if (key == '5') {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
-        // Add your code for computing quadratic fitted vertex normals here:
-        // store in N_quadraticFit
-
-        // Use igl::per_vertex_normals to orient your normals consistently (i.e. to choose consistent signs for the normals).
+        quadraticFit();
 
         // Set the viewer normals.
         N_quadraticFit.rowwise().normalize();
@@ -129,11 +437,8 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
         colors_per_vertex.setZero(V.rows(),3);
-        // Add your code for computing the discrete mean curvature:
-        // store in K_mean
-
-        // For visualization, better to normalize the range of K_mean with the maximal and minimal curvatures.
-        // store colors in colors_per_vertex
+        K_mean = curvatureCache().mean;
+        igl::jet(K_mean, true, colors_per_vertex);
 
         // Set the viewer colors
         viewer.data().set_colors(colors_per_vertex);
@@ -143,11 +448,8 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
         colors_per_vertex.setZero(V.rows(),3);
-        // Add your code for computing the discrete Gaussian curvature:
-        // store in K_Gaussian
-
-        // For visualization, better to normalize the range of K_Gaussian with the maximal and minimal curvatures.
-        // store colors in colors_per_vertex
+        K_Gaussian = curvatureCache().gaussian;
+        igl::jet(K_Gaussian, true, colors_per_vertex);
 
         // Set the viewer colors
         viewer.data().set_colors(colors_per_vertex);
@@ -157,18 +459,14 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
         colors_per_vertex.setZero(V.rows(),3);
-        // Add your code for computing the discrete minimal principal curvature:
-        // store in K_min_principal
-       
-        // For visualization, better to normalize the range of K_min_principal with the maximal and minimal curvatures.
-        // store colors in colors_per_vertex
-
-        // Uncomment the code below to draw a blue segment parallel to the minimal curvature direction, 
-        
-        // const double avg = igl::avg_edge_length(V,F);
-        // Eigen::Vector3d blue(0.2,0.2,0.8);
-        // viewer.data().add_edges(V + PD_min*avg, V - PD_min*avg, blue);
-        
+        principalCurvatures();
+        igl::jet(K_min_principal, true, colors_per_vertex);
+
+        // Draw a blue segment parallel to the minimal curvature direction
+        const double avg = igl::avg_edge_length(V,F);
+        Eigen::RowVector3d blue(0.2,0.2,0.8);
+        viewer.data().add_edges(V + PD_min*avg, V - PD_min*avg, blue);
+
         // Set the viewer colors
         viewer.data().set_colors(colors_per_vertex);
     }
@@ -177,26 +475,38 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
         viewer.data().clear();
         viewer.data().set_mesh(V, F);
         colors_per_vertex.setZero(V.rows(),3);
-        // Add your code for computing the discrete maximal principal curvature:
-        // store in K_max_principal
-
-        // For visualization, better to normalize the range of K_max_principal with the maximal and minimal curvatures
-        // store colors in colors_per_vertex
-        
-        // Uncomment the code below to draw a red segment parallel to the maximal curvature direction
-        
-        // const double avg = igl::avg_edge_length(V,F);
-        // Eigen::Vector3d red(0.8,0.2,0.2);
-        // viewer.data().add_edges(V + PD_max*avg, V - PD_max*avg, red);
-        
+        principalCurvatures();
+        igl::jet(K_max_principal, true, colors_per_vertex);
+
+        // Draw a red segment parallel to the maximal curvature direction
+        const double avg = igl::avg_edge_length(V,F);
+        Eigen::RowVector3d red(0.8,0.2,0.2);
+        viewer.data().add_edges(V + PD_max*avg, V - PD_max*avg, red);
+
+        // Set the viewer colors
+        viewer.data().set_colors(colors_per_vertex);
+    }
+
+    if (key == 'M') {
+        viewer.data().clear();
+        viewer.data().set_mesh(V, F);
+        colors_per_vertex.setZero(V.rows(),3);
+        multiScaleCurvature();
+        igl::jet(K_mean, true, colors_per_vertex);
+
         // Set the viewer colors
         viewer.data().set_colors(colors_per_vertex);
     }
 
     if (key == 'E') {
-        // Add your code for computing explicit Laplacian smoothing here:
-        // store the smoothed vertices in V_expLap
-        V_expLap = V;
+        // Explicit Laplacian smoothing, explicitIterations steps per key press
+        if (progressiveSmoothing) {
+            const double lambda = explicitLambda;
+            startProgressiveSmoothing(viewer, V_expLap, explicitIterations,
+                                      [lambda](Eigen::MatrixXd& X) { explicitSmoother.smooth(X, lambda, 1); });
+        }
+        else
+            explicitSmoother.smooth(V_expLap, explicitLambda, explicitIterations);
 
         // Set the smoothed mesh
         viewer.data().clear();
@@ -204,9 +514,16 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
     }
 
     if (key == 'D'){
-        // Implicit smoothing for comparison
-        // store the smoothed vertices in V_impLap
-        V_impLap = V;
+        // Implicit smoothing for comparison, implicitIterations steps per key press
+        // The time step is captured, the menu may change it during a
+        // background run.
+        const double timeStep = implicitTimeStep;
+        if (progressiveSmoothing)
+            startProgressiveSmoothing(viewer, V_impLap, implicitIterations,
+                                      [timeStep](Eigen::MatrixXd& X) { implicitSmoothingStep(X, timeStep); });
+        else
+            for (int i = 0; i < implicitIterations; ++i)
+                implicitSmoothingStep(V_impLap, timeStep);
 
         // Set the smoothed mesh
         viewer.data().clear();
@@ -214,11 +531,17 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
     }
 
     if (key == 'B') {
-        // Add your code for computing bilateral smoothing here:
-        // store the smoothed vertices in V_bilateral
-        // be careful of the sign mistake in the paper
-        // use v' = v - n * (sum / normalizer) to update
-        V_bilateral = V;
+        // Bilateral denoising, bilateralIterations steps per key press. The
+        // neighbourhoods are kept as long as the radius does not change.
+        const double sigma = bilateralSigma * igl::avg_edge_length(V, F);
+        if (bilateralDenoiser.radius() != 2 * sigma)
+            bilateralDenoiser.set_neighbourhoods(V_bilateral, 2 * sigma);
+        if (progressiveSmoothing)
+            startProgressiveSmoothing(viewer, V_bilateral, bilateralIterations, [sigma](Eigen::MatrixXd& X) {
+                bilateralDenoiser.denoise(geometry, sigma, 1, X);
+            });
+        else
+            bilateralDenoiser.denoise(geometry, sigma, bilateralIterations, V_bilateral);
 
         // Set the smoothed mesh
         viewer.data().clear();
@@ -226,12 +549,43 @@ bool callback_key_down(Viewer& viewer, unsigned char key, int modifiers) {
     }
 
 
+    if (key == 'S') {
+        // Spectral smoothing, the filter is set in the menu
+        spectralSmoothing();
+
+        // Set the smoothed mesh
+        viewer.data().clear();
+        viewer.data().set_mesh(V_spectral, F);
+    }
+
     return true;
 }
 
+// Rebuild the caches and operators of (V, F) and reset the smoothed copies.
+void prepareMesh() {
+    geometry.set_mesh(V, F);
+    laplacian.set_topology(geometry);
+    laplacian.assemble(geometry);
+    explicitSmoother.set_laplacian(laplacian.L);
+    V_expLap = V;
+    V_bilateral = V;
+    bilateralDenoiser = BilateralDenoiser();
+    spectralSmoother = SpectralSmoother();
+    impLapGeometry = geometry;
+    impLapOperators.set_topology(geometry);
+    implicitSmoother.set_pattern(impLapOperators.L);
+    V_impLap = V;
+    neighbourhoods.set_points(V);
+    curvaturesValid = false;
+    multiScale = MultiScaleCurvatures();
+}
+
 bool load_mesh(Viewer& viewer,string filename, Eigen::MatrixXd& V, Eigen::MatrixXi& F)
 {
+    stopProgressiveSmoothing(viewer);
     igl::read_triangle_mesh(filename, V, F);
+    reorder_mesh(V, F, meshOrdering, meshPermutation);
+    prepareMesh();
     viewer.data().clear();
     viewer.data().set_mesh(V,F);
     viewer.data().compute_normals();
@@ -251,11 +605,277 @@ std::string find_data_dir() {
   throw "Could not find data directory";
 }
 
+// Splits a comma separated list, e.g. "bunny,eight".
+template <typename T>
+vector<T> parseList(const string& list) {
+    vector<T> values;
+    stringstream tokens(list);
+    string token;
+    while (getline(tokens, token, ',')) {
+        stringstream value(token);
+        T v;
+        if (value >> v)
+            values.push_back(v);
+    }
+    return values;
+}
+
+// Angles in degrees between the rows of the unit normals N and N_ref, as
+// mean, 95th percentile and maximum.
+Eigen::Vector3d angularError(const Eigen::MatrixXd& N, const Eigen::MatrixXd& N_ref) {
+    Eigen::VectorXd angles(N.rows());
+    for (int i = 0; i < N.rows(); ++i)
+        angles(i) = acos(std::min(std::max(N.row(i).dot(N_ref.row(i)), -1.0), 1.0)) * 180 / M_PI;
+    const double mean = angles.mean();
+    std::sort(angles.data(), angles.data() + angles.size());
+    return Eigen::Vector3d(mean, angles(std::min<int>(angles.size() - 1, 0.95 * angles.size())),
+                           angles(angles.size() - 1));
+}
+
+// Resets the peak resident set size of the process (VmHWM) to its current
+// resident size, so that peakMemoryMB measures the runs that follow. Returns
+// false where /proc/self/clear_refs is not available.
+bool resetPeakMemory() {
+    ofstream clearRefs("/proc/self/clear_refs");
+    return clearRefs && (clearRefs << "5") && clearRefs.flush();
+}
+
+// Peak resident set size of the process since the last resetPeakMemory, in
+// MB. Without /proc, the peak over the whole lifetime of the process.
+double peakMemoryMB() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return atof(line.c_str() + 6) / 1024;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Headless benchmark of the normal estimators and smoothers:
+//   assignment3 --bench [--data bunny,Julius,bumpy-cube,cheburashka,eight]
+//               [--normals uniform,area,mean,pca,quadratic]
+//               [--smoothing explicit,implicit,bilateral,spectral]
+//               [--order none,morton,rcm] [--out results.csv]
+// For every dataset, loads <name>_noisy, estimates its normals with every
+// method and smooths it with every smoother using the current parameters
+// (kNearest, explicitIterations, ...). It writes one CSV row per run with
+// the time, throughput and peak resident memory during that run, and the
+// angles between the result's normals and the area-weighted normals of the
+// clean mesh <name>. Smoothing rows also give the RMS distance to the clean
+// vertices, in average edge lengths. The octree is built when loading and is
+// not timed; the vertices are reordered as when loading, with every given
+// ordering.
+int runBenchmark(int argc, char *argv[]) {
+    vector<string> datasets = {"bunny", "Julius", "bumpy-cube", "cheburashka", "eight"};
+    vector<string> normalMethods = {"uniform", "area", "mean", "pca", "quadratic"};
+    vector<string> smoothers = {"explicit", "implicit", "bilateral"};
+    vector<string> orders = {"morton"};
+    string out;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--data")
+            datasets = parseList<string>(value);
+        else if (option == "--normals")
+            normalMethods = parseList<string>(value);
+        else if (option == "--smoothing")
+            smoothers = parseList<string>(value);
+        else if (option == "--order")
+            orders = parseList<string>(value);
+        else if (option == "--out")
+            out = value;
+        else {
+            cerr << "Unknown benchmark option " << option << endl;
+            return 1;
+        }
+    }
+
+    ofstream file;
+    if (!out.empty())
+        file.open(out);
+    ostream& csv = out.empty() ? cout : file;
+    csv << "dataset,vertices,order,stage,method,ms,vertices_per_s,mean_angle_deg,p95_angle_deg,max_angle_deg,"
+           "rms_distance,peak_memory_mb"
+        << endl;
+
+    using Clock = chrono::steady_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return chrono::duration<double, milli>(b - a).count();
+    };
+    // Data files are .obj or .off.
+    auto findMesh = [](const string& name) {
+        struct stat info;
+        const string path = find_data_dir() + name;
+        return stat((path + ".obj").c_str(), &info) == 0 ? path + ".obj" : path + ".off";
+    };
+
+    for (const string& dataset : datasets)
+    for (const string& order : orders) {
+        Eigen::MatrixXd V_clean, N_clean;
+        Eigen::MatrixXi F_clean;
+        if (!igl::read_triangle_mesh(findMesh(dataset), V_clean, F_clean) ||
+            !igl::read_triangle_mesh(findMesh(dataset + "_noisy"), V, F) || V.rows() != V_clean.rows()) {
+            cerr << "Could not load the clean and noisy " << dataset << endl;
+            continue;
+        }
+        igl::per_vertex_normals(V_clean, F_clean, igl::PER_VERTEX_NORMALS_WEIGHTING_TYPE_AREA, N_clean);
+        const double edgeLength = igl::avg_edge_length(V_clean, F_clean);
+        // Some pairs are stored with opposite orientations
+        Eigen::MatrixXd N_noisy;
+        igl::per_vertex_normals(V, F, igl::PER_VERTEX_NORMALS_WEIGHTING_TYPE_AREA, N_noisy);
+        if ((N_noisy.array() * N_clean.array()).sum() < 0)
+            N_clean = -N_clean;
+        MeshPermutation permutation;
+        reorder_mesh(V, F, order == "rcm" ? MESH_ORDER_RCM : order == "morton" ? MESH_ORDER_MORTON : MESH_ORDER_NONE,
+                     permutation);
+        gather_rows(permutation.vertices, V_clean, V_clean);
+        gather_rows(permutation.vertices, N_clean, N_clean);
+        prepareMesh();
+
+        auto report = [&](const string& stage, const string& method, double time, double peak,
+                          const Eigen::MatrixXd& N, const string& distance) {
+            const Eigen::Vector3d error = angularError(N, N_clean);
+            csv << dataset << ',' << V.rows() << ',' << order << ',' << stage << ',' << method << ',' << time << ','
+                << V.rows() / max(time, 1e-6) * 1000 << ',' << error(0) << ',' << error(1) << ',' << error(2)
+                << ',' << distance << ',' << peak << endl;
+        };
+
+        for (const string& method : normalMethods) {
+            // Start from the geometry and neighbourhoods of a fresh load
+            geometry.invalidate();
+            neighbourhoods.set_points(V);
+            Eigen::MatrixXd N;
+            resetPeakMemory();
+            auto t0 = Clock::now();
+            if (method == "uniform")
+                faceAveragedNormals(false, N);
+            else if (method == "area")
+                faceAveragedNormals(true, N);
+            else if (method == "mean")
+                meanCurvatureNormals(N);
+            else if (method == "pca")
+                pcaNormals(N);
+            else if (method == "quadratic") {
+                quadraticFit();
+                N = N_quadraticFit;
+            }
+            else {
+                cerr << "Unknown normal estimator " << method << endl;
+                continue;
+            }
+            auto t1 = Clock::now();
+            const double peak = peakMemoryMB();
+            N.rowwise().normalize();
+            report("normals", method, ms(t0, t1), peak, N, "");
+        }
+
+        for (const string& smoother : smoothers) {
+            geometryCache();
+            Eigen::MatrixXd X = V;
+            resetPeakMemory();
+            auto t0 = Clock::now();
+            if (smoother == "explicit")
+                explicitSmoother.smooth(X, explicitLambda, explicitIterations);
+            else if (smoother == "implicit")
+                for (int i = 0; i < implicitIterations; ++i)
+                    implicitSmoothingStep(X, implicitTimeStep);
+            else if (smoother == "bilateral") {
+                const double sigma = bilateralSigma * igl::avg_edge_length(V, F);
+                bilateralDenoiser.set_neighbourhoods(X, 2 * sigma);
+                bilateralDenoiser.denoise(geometry, sigma, bilateralIterations, X);
+            }
+            else if (smoother == "spectral") {
+                spectralSmoother = SpectralSmoother();
+                spectralSmoothing();
+                X = V_spectral;
+            }
+            else {
+                cerr << "Unknown smoother " << smoother << endl;
+                continue;
+            }
+            auto t1 = Clock::now();
+            const double peak = peakMemoryMB();
+            Eigen::MatrixXd N;
+            igl::per_vertex_normals(X, F, igl::PER_VERTEX_NORMALS_WEIGHTING_TYPE_AREA, N);
+            const double distance = sqrt((X - V_clean).rowwise().squaredNorm().mean()) / edgeLength;
+            report("smoothing", smoother, ms(t0, t1), peak, N, to_string(distance));
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
+    if (argc > 1 && string(argv[1]) == "--bench")
+        return runBenchmark(argc, argv);
+
     // Show the mesh
     Viewer& viewer = Viewer::get_instance();
     Viewer::Menu& menu = viewer.menu();
     viewer.callback_key_down = callback_key_down;
+    viewer.callback_pre_draw = callback_pre_draw;
+
+    menu.callback_draw_viewer_menu = [&]() {
+        // Draw parent menu content
+        menu.draw_viewer_menu();
+
+        if (ImGui::CollapsingHeader("Curvature Options", ImGuiTreeNodeFlags_DefaultOpen)) {
+            // The quadratic fit needs at least 6 neighbours
+            if (ImGui::InputInt("k nearest", &kNearest, 0, 0)) {
+                kNearest = std::max(kNearest, 6);
+                multiScale = MultiScaleCurvatures();
+            }
+            ImGui::Checkbox("Principal from quadratic fit", &principalFromQuadraticFit);
+            if (ImGui::Combo("Curvature scales", &curvatureScaleMode, curvatureScaleModes,
+                             IM_ARRAYSIZE(curvatureScaleModes)))
+                multiScale = MultiScaleCurvatures();
+            if (ImGui::InputInt("Number of scales", &curvatureScales, 0, 0))
+                curvatureScales = std::max(curvatureScales, 1);
+            if (ImGui::InputDouble("Scale radius", &curvatureRadius, 0, 0))
+                multiScale = MultiScaleCurvatures();
+            // Follows the slider once the curvatures have been computed with 'M'
+            if (ImGui::SliderInt("Curvature scale", &curvatureScale, 1, curvatureScales) &&
+                multiScale.mean.cols() == curvatureScales) {
+                multiScaleCurvature();
+                igl::jet(K_mean, true, colors_per_vertex);
+                viewer.data().set_colors(colors_per_vertex);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Smoothing Options", ImGuiTreeNodeFlags_DefaultOpen)) {
+            ImGui::InputDouble("Explicit lambda", &explicitLambda, 0, 0);
+            ImGui::InputInt("Explicit iterations", &explicitIterations, 0, 0);
+            ImGui::InputInt("Implicit iterations", &implicitIterations, 0, 0);
+            ImGui::InputDouble("Implicit time step", &implicitTimeStep, 0, 0);
+            if (ImGui::InputDouble("Bilateral sigma", &bilateralSigma, 0, 0))
+                bilateralSigma = std::max(bilateralSigma, 1e-3);
+            if (ImGui::InputInt("Bilateral iterations", &bilateralIterations, 0, 0))
+                bilateralIterations = std::max(bilateralIterations, 0);
+            if (ImGui::InputInt("Spectral basis size", &spectralBasisSize, 0, 0))
+                spectralSmoother = SpectralSmoother();
+            // Follows the slider once the basis has been computed with 'S'
+            if (ImGui::SliderInt("Spectral frequencies", &spectralFrequencies, 1, spectralBasisSize) &&
+                spectralSmoother.size() > 0) {
+                spectralSmoothing();
+                viewer.data().set_vertices(V_spectral);
+                viewer.data().compute_normals();
+            }
+            ImGui::Checkbox("Progressive smoothing", &progressiveSmoothing);
+            if (progressive.running()) {
+                ImGui::Text("Iteration %d", progressive.iterations_done());
+                if (ImGui::Button("Stop smoothing", ImVec2(-1, 0)))
+                    stopProgressiveSmoothing(viewer);
+            }
+            if (ImGui::Button("Reset smoothing", ImVec2(-1, 0))) {
+                stopProgressiveSmoothing(viewer);
+                V_expLap = V;
+                V_impLap = V;
+                V_bilateral = V;
+                viewer.data().clear();
+                viewer.data().set_mesh(V, F);
+            }
+        }
+    };
 
     std::string filename;
     if (argc == 2) {
@@ -0,0 +1,57 @@
+#include "ArapSolver.h"
+#include <igl/parallel_for.h>
+
+using namespace std;
+using namespace Eigen;
+
+bool ArapSolver::precompute(const SparseMatrix<double, RowMajor> &D_,
+                            const VectorXd &areas, const VectorXi &fixed,
+                            SolverBackend backend) {
+  D = D_;
+  VectorXd weights(2 * areas.size());
+  weights << areas, areas;
+  DtA = D.transpose() * weights.asDiagonal();
+  return solver.factor(DtA * D, fixed, true, backend);
+}
+
+void ArapSolver::jacobians(const MatrixXd &UV, MatrixXd &J) const {
+  const MatrixXd G = D * UV;
+  const int m = G.rows() / 2;
+  J.resize(m, 4);
+  J.col(0) = G.col(0).head(m);
+  J.col(1) = G.col(0).tail(m);
+  J.col(2) = G.col(1).head(m);
+  J.col(3) = G.col(1).tail(m);
+}
+
+void ArapSolver::local_step(const MatrixXd &J, MatrixXd &R) {
+  const int m = J.rows(), block = 4096;
+  R.resize(m, 4);
+  igl::parallel_for(
+      (m + block - 1) / block,
+      [&](int k) {
+        const int begin = k * block, size = min(block, m - begin);
+        auto c = R.col(0).segment(begin, size).array();
+        auto s = R.col(2).segment(begin, size).array();
+        auto r = R.col(1).segment(begin, size).array();
+        c = J.col(0).segment(begin, size).array() +
+            J.col(3).segment(begin, size).array();
+        s = J.col(2).segment(begin, size).array() -
+            J.col(1).segment(begin, size).array();
+        r = (c.square() + s.square()).sqrt();
+        c = (r > 0).select(c / r, 1.0);
+        s = (r > 0).select(s / r, 0.0);
+        r = -s;
+        R.col(3).segment(begin, size) = R.col(0).segment(begin, size);
+      },
+      1);
+}
+
+void ArapSolver::global_step(const MatrixXd &R, const MatrixXd &fixed_positions,
+                             MatrixXd &UV) {
+  // Right-hand sides of u and v as the two columns, from the rotations
+  // stacked like the gradients.
+  MatrixXd stacked(2 * R.rows(), 2);
+  stacked << R.col(0), R.col(2), R.col(1), R.col(3);
+  solver.solve(DtA * stacked, fixed_positions, UV);
+}
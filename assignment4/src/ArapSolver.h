@@ -0,0 +1,69 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+#include "ConstrainedSolver.h"
+
+// Global step of the as-rigid-as-possible (ARAP) parameterization with a
+// prefactored system.
+//
+// The global step minimizes sum_f A_f ||J_f - R_f||^2 over the UV coordinates,
+// where J_f = [D1 u, D2 u; D1 v, D2 v] is the Jacobian of face f and R_f the
+// rotation found for it by the local step. The normal equations are block
+// diagonal in u and v, with the same matrix K = D1^T A D1 + D2^T A D2 for
+// both blocks, and K does not depend on the rotations. precompute therefore
+// factors K once with the fixed vertices eliminated (see ConstrainedSolver.h,
+// a sparse LDLT by default). Every iteration only forms the right-hand sides
+// with one sparse product and back-substitutes for u and v together.
+class ArapSolver {
+public:
+  // Assemble and factor the reduced system.
+  //
+  // Inputs:
+  //   D  2#F x #V stacked surface gradients [D1; D2] along the two local face
+  //      axes, see SurfaceGradient.h
+  //   areas  #F face areas
+  //   fixed  indices of the fixed vertices, at least one per connected
+  //          component
+  //   backend  solver backend
+  // Returns false if the factorization fails.
+  bool precompute(const Eigen::SparseMatrix<double, Eigen::RowMajor> &D,
+                  const Eigen::VectorXd &areas, const Eigen::VectorXi &fixed,
+                  SolverBackend backend = SOLVER_AUTO);
+
+  // Jacobians of all faces for the parameterization UV, #F x4 with the
+  // entries J00, J01, J10, J11 of each face in a row. The matrix is column
+  // major, so each entry is a contiguous array over the faces.
+  void jacobians(const Eigen::MatrixXd &UV, Eigen::MatrixXd &J) const;
+
+  // Local step: the rotations closest to the Jacobians J, laid out like J.
+  //
+  // The closest rotation to [a b; c d] in the Frobenius norm is the rotation
+  // by the angle of (a + d, c - b), which is what U V^T of its signed SVD
+  // reduces to. Normalizing that vector gives the cosine and sine directly,
+  // without atan2, cos and sin, and the four columns are processed as arrays
+  // in blocks of faces spread over the threads. A vanishing Jacobian maps to
+  // the identity.
+  static void local_step(const Eigen::MatrixXd &J, Eigen::MatrixXd &R);
+
+  // Global step: the UV coordinates closest to the rotations R (#F x4, laid
+  // out like the Jacobians), with the fixed vertices at fixed_positions
+  // (#fixed x2, in the order given to precompute).
+  void global_step(const Eigen::MatrixXd &R,
+                   const Eigen::MatrixXd &fixed_positions,
+                   Eigen::MatrixXd &UV);
+
+  bool valid() const { return solver.valid(); }
+
+  // Drop the factorization, e.g. when a new mesh is loaded.
+  void reset() { solver.reset(); }
+
+  // Factorization and last solve of the global step.
+  const SolverStats &stats() const { return solver.stats(); }
+
+private:
+  Eigen::SparseMatrix<double, Eigen::RowMajor> D;
+  // [D1; D2]^T diag(A, A), #V x 2#F, for the right-hand sides
+  Eigen::SparseMatrix<double> DtA;
+  ConstrainedSolver solver;
+};
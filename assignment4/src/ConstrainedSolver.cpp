@@ -0,0 +1,142 @@
+#include "ConstrainedSolver.h"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+using namespace Eigen;
+
+typedef chrono::steady_clock Clock;
+
+static double milliseconds(Clock::time_point start) {
+  return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+ostream &operator<<(ostream &out, const SolverStats &stats) {
+  return out << stats.backend << ", " << stats.unknowns << " unknowns, "
+             << stats.matrix_nonzeros << " nonzeros, factor "
+             << stats.factor_nonzeros << " nonzeros ("
+             << (double)stats.factor_nonzeros / max(stats.matrix_nonzeros, 1L)
+             << "x), factor " << stats.factor_ms << " ms, solve "
+             << stats.solve_ms << " ms";
+}
+
+bool ConstrainedSolver::factor(const SparseMatrix<double> &A,
+                               const VectorXi &fixed, bool symmetric,
+                               SolverBackend backend) {
+  const auto start = Clock::now();
+  method = backend != SOLVER_AUTO ? backend
+                                  : (symmetric ? SOLVER_LDLT : SOLVER_LU);
+  n = A.rows();
+
+  // Split the unknowns into free and fixed ones.
+  slot.assign(n, -1);
+  fixed_unknowns.clear();
+  value_rows.clear();
+  free_unknowns.clear();
+  for (int k = 0; k < fixed.size(); ++k)
+    if (slot[fixed(k)] < 0) {
+      slot[fixed(k)] = fixed_unknowns.size();
+      fixed_unknowns.push_back(fixed(k));
+      value_rows.push_back(k);
+    }
+  for (int i = 0; i < n; ++i)
+    if (slot[i] < 0) {
+      slot[i] = free_unknowns.size();
+      free_unknowns.push_back(i);
+    }
+  vector<bool> is_fixed(n, false);
+  for (int i : fixed_unknowns)
+    is_fixed[i] = true;
+
+  SparseMatrix<double> system;
+  if (method == SOLVER_KKT) {
+    // [A C^T; C 0], with one row of C per fixed unknown.
+    const int k = fixed_unknowns.size();
+    vector<Triplet<double>> triplets;
+    triplets.reserve(A.nonZeros() + 2 * k);
+    for (int j = 0; j < A.outerSize(); ++j)
+      for (SparseMatrix<double>::InnerIterator it(A, j); it; ++it)
+        triplets.emplace_back(it.row(), j, it.value());
+    for (int c = 0; c < k; ++c) {
+      triplets.emplace_back(n + c, fixed_unknowns[c], 1);
+      triplets.emplace_back(fixed_unknowns[c], n + c, 1);
+    }
+    system.resize(n + k, n + k);
+    system.setFromTriplets(triplets.begin(), triplets.end());
+  } else {
+    vector<Triplet<double>> ff, fc;
+    for (int j = 0; j < A.outerSize(); ++j)
+      for (SparseMatrix<double>::InnerIterator it(A, j); it; ++it) {
+        if (is_fixed[it.row()])
+          continue;
+        if (is_fixed[j])
+          fc.emplace_back(slot[it.row()], slot[j], it.value());
+        else
+          ff.emplace_back(slot[it.row()], slot[j], it.value());
+      }
+    system.resize(free_unknowns.size(), free_unknowns.size());
+    system.setFromTriplets(ff.begin(), ff.end());
+    A_fc.resize(free_unknowns.size(), fixed_unknowns.size());
+    A_fc.setFromTriplets(fc.begin(), fc.end());
+  }
+
+  last = SolverStats();
+  last.unknowns = system.rows();
+  if (method == SOLVER_LDLT) {
+    last.backend = "LDLT";
+    last.matrix_nonzeros =
+        SparseMatrix<double>(system.triangularView<Lower>()).nonZeros();
+    ldlt.compute(system);
+    factorized = ldlt.info() == Success;
+    if (factorized)
+      last.factor_nonzeros =
+          ldlt.matrixL().nestedExpression().nonZeros() + system.rows();
+  } else {
+    last.matrix_nonzeros = system.nonZeros();
+    last.backend = method == SOLVER_KKT ? "KKT (LU)" : "LU";
+    lu.compute(system);
+    factorized = lu.info() == Success;
+    if (factorized)
+      last.factor_nonzeros = lu.nnzL() + lu.nnzU();
+  }
+  last.factor_ms = milliseconds(start);
+  if (!factorized)
+    cerr << "ConstrainedSolver: " << last.backend << " factorization failed"
+         << endl;
+  return factorized;
+}
+
+bool ConstrainedSolver::solve(const MatrixXd &b, const MatrixXd &values,
+                              MatrixXd &x) {
+  if (!factorized)
+    return false;
+  const auto start = Clock::now();
+  const int k = fixed_unknowns.size();
+  MatrixXd fixed_values(k, b.cols());
+  for (int c = 0; c < k; ++c)
+    fixed_values.row(c) = values.row(value_rows[c]);
+
+  if (method == SOLVER_KKT) {
+    MatrixXd rhs(n + k, b.cols());
+    rhs << b, fixed_values;
+    x = lu.solve(rhs).topRows(n);
+  } else {
+    MatrixXd rhs(free_unknowns.size(), b.cols());
+    for (int i = 0; i < (int)free_unknowns.size(); ++i)
+      rhs.row(i) = b.row(free_unknowns[i]);
+    rhs -= A_fc * fixed_values;
+    MatrixXd x_free;
+    if (method == SOLVER_LDLT)
+      x_free = ldlt.solve(rhs);
+    else
+      x_free = lu.solve(rhs);
+
+    x.resize(n, b.cols());
+    for (int i = 0; i < (int)free_unknowns.size(); ++i)
+      x.row(free_unknowns[i]) = x_free.row(i);
+    for (int c = 0; c < k; ++c)
+      x.row(fixed_unknowns[c]) = fixed_values.row(c);
+  }
+  last.solve_ms = milliseconds(start);
+  return x.allFinite();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseLU>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Sparse solver backends for the parameterization systems.
+//   SOLVER_LDLT  eliminate the fixed unknowns and factor the reduced matrix
+//                with a sparse LDLT, for symmetric positive definite systems
+//   SOLVER_LU    eliminate the fixed unknowns and factor the reduced matrix
+//                with SparseLU
+//   SOLVER_KKT   keep the constraints as Lagrange multipliers and factor the
+//                saddle point system [A C^T; C 0] with SparseLU
+//   SOLVER_AUTO  SOLVER_LDLT for symmetric systems, SOLVER_LU otherwise
+enum SolverBackend { SOLVER_AUTO, SOLVER_LDLT, SOLVER_LU, SOLVER_KKT };
+
+// Size and timings of the last factorization and solve.
+struct SolverStats {
+  std::string backend;
+  // unknowns and stored nonzeros of the factored matrix: the lower triangle
+  // for LDLT, which only reads that, the whole matrix for LU
+  int unknowns = 0;
+  long matrix_nonzeros = 0;
+  // nonzeros of L and D for LDLT, of L and U for LU, so that the ratio of the
+  // two counts is the fill-in of either backend
+  long factor_nonzeros = 0;
+  double factor_ms = 0, solve_ms = 0;
+};
+
+std::ostream &operator<<(std::ostream &out, const SolverStats &stats);
+
+// Solves A x = b with some of the unknowns fixed, x(fixed) = values, for any
+// number of right-hand sides sharing A and the fixed unknowns.
+//
+// With the fixed unknowns eliminated, the free ones solve
+// A_ff x_f = b_f - A_fc x_c. For the Laplacians of Tutte and harmonic
+// parameterization, the LSCM normal equations and the ARAP global step, A is
+// symmetric positive semidefinite and A_ff positive definite once enough
+// unknowns are fixed, so a sparse LDLT of the reduced matrix replaces the LU
+// of the KKT system, which is about twice as large and not symmetric.
+class ConstrainedSolver {
+public:
+  // Factor the system.
+  //
+  // Inputs:
+  //   A  n x n system matrix
+  //   fixed  indices of the fixed unknowns
+  //   symmetric  whether A is symmetric positive semidefinite with A_ff
+  //              positive definite
+  //   backend  solver backend
+  // Returns false if the factorization fails.
+  bool factor(const Eigen::SparseMatrix<double> &A,
+              const Eigen::VectorXi &fixed, bool symmetric,
+              SolverBackend backend = SOLVER_AUTO);
+
+  // Solve for the right-hand sides b (n x k) with the fixed unknowns set to
+  // values (#fixed x k, in the order given to factor), into x (n x k).
+  // Returns false if the solve fails.
+  bool solve(const Eigen::MatrixXd &b, const Eigen::MatrixXd &values,
+             Eigen::MatrixXd &x);
+
+  bool valid() const { return factorized; }
+
+  // Drop the factorization, e.g. when a new mesh is loaded.
+  void reset() { factorized = false; }
+
+  const SolverStats &stats() const { return last; }
+
+private:
+  SolverBackend method = SOLVER_LDLT;
+  int n = 0;
+  // Free and fixed unknowns, and the position of every unknown among them
+  std::vector<int> free_unknowns, fixed_unknowns, slot;
+  // Row of values of each fixed unknown, duplicates dropped
+  std::vector<int> value_rows;
+  // Coupling of the free to the fixed unknowns, #free x #fixed
+  Eigen::SparseMatrix<double> A_fc;
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt;
+  Eigen::SparseLU<Eigen::SparseMatrix<double>> lu;
+  SolverStats last;
+  bool factorized = false;
+};
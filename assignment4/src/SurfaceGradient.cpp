@@ -0,0 +1,80 @@
+#include "SurfaceGradient.h"
+#include <Eigen/Geometry>
+#include <igl/parallel_for.h>
+#include <algorithm>
+
+using namespace std;
+using namespace Eigen;
+
+namespace {
+// Column indices of face f in increasing order, and the derivatives of their
+// hat functions along the two axes of the face basis.
+void face_gradient(const MatrixXd &V, const MatrixXi &F, int f, int columns[3],
+                   double g1[3], double g2[3]) {
+  const Vector3d p0 = V.row(F(f, 0)), p1 = V.row(F(f, 1)),
+                 p2 = V.row(F(f, 2));
+  // The face in the basis of igl::local_basis: p0 at the origin, p1 on the
+  // first axis and p2 above it.
+  const Vector3d e = p1 - p0, t = p2 - p0;
+  const Vector3d b1 = e.normalized();
+  const Vector3d b2 = b1.cross(t).normalized().cross(b1);
+  const Vector2d q[3] = {Vector2d(0, 0), Vector2d(e.norm(), 0),
+                         Vector2d(t.dot(b1), t.dot(b2))};
+  const double twice_area = q[1](0) * q[2](1);
+
+  int order[3] = {0, 1, 2};
+  sort(order, order + 3, [&](int a, int b) { return F(f, a) < F(f, b); });
+  for (int k = 0; k < 3; ++k) {
+    const int c = order[k];
+    columns[k] = F(f, c);
+    if (twice_area > 0) {
+      // The gradient is the opposite edge q_j -> q_l turned by 90 degrees.
+      const Vector2d edge = q[(c + 2) % 3] - q[(c + 1) % 3];
+      g1[k] = -edge(1) / twice_area;
+      g2[k] = edge(0) / twice_area;
+    } else {
+      g1[k] = g2[k] = 0;
+    }
+  }
+}
+
+// A row-major matrix with three entries in every row, ready to be filled.
+void allocate(SparseMatrix<double, RowMajor> &D, int rows, int cols) {
+  D.resize(rows, cols);
+  D.resizeNonZeros(3 * rows);
+  for (int r = 0; r <= rows; ++r)
+    D.outerIndexPtr()[r] = 3 * r;
+}
+} // namespace
+
+void surface_gradient(const MatrixXd &V, const MatrixXi &F,
+                      SparseMatrix<double, RowMajor> &D1,
+                      SparseMatrix<double, RowMajor> &D2) {
+  const int m = F.rows();
+  allocate(D1, m, V.rows());
+  allocate(D2, m, V.rows());
+  igl::parallel_for(
+      m,
+      [&](int f) {
+        face_gradient(V, F, f, D1.innerIndexPtr() + 3 * f,
+                      D1.valuePtr() + 3 * f, D2.valuePtr() + 3 * f);
+        copy(D1.innerIndexPtr() + 3 * f, D1.innerIndexPtr() + 3 * f + 3,
+             D2.innerIndexPtr() + 3 * f);
+      },
+      1000);
+}
+
+void surface_gradient(const MatrixXd &V, const MatrixXi &F,
+                      SparseMatrix<double, RowMajor> &D) {
+  const int m = F.rows();
+  allocate(D, 2 * m, V.rows());
+  igl::parallel_for(
+      m,
+      [&](int f) {
+        int *columns = D.innerIndexPtr();
+        face_gradient(V, F, f, columns + 3 * f, D.valuePtr() + 3 * f,
+                      D.valuePtr() + 3 * (m + f));
+        copy(columns + 3 * f, columns + 3 * f + 3, columns + 3 * (m + f));
+      },
+      1000);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+// Surface gradient operators in the local basis of every face, the D1 and D2
+// of the parameterization energies: (D1 u)_f and (D2 u)_f are the derivatives
+// of the piecewise linear function u along the two axes of igl::local_basis
+// on face f.
+//
+// They equal the products of the rows of igl::grad with the basis vectors,
+// but are assembled directly. The gradient of a hat function on a face is its
+// opposite edge, expressed in the face basis, turned by 90 degrees and divided
+// by twice the area. Every row holds the three entries of one face, so the
+// row-major storage is allocated up front and filled in one parallel pass
+// over the faces, without the 3#F x #V gradient or any intermediate sums.
+
+// Inputs:
+//   V  #V x3 vertex positions
+//   F  #F x3 faces
+// Outputs:
+//   D1, D2  #F x #V gradients along the first and second axis
+void surface_gradient(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F,
+                      Eigen::SparseMatrix<double, Eigen::RowMajor> &D1,
+                      Eigen::SparseMatrix<double, Eigen::RowMajor> &D2);
+
+// Same, stacked as D = [D1; D2], 2#F x #V. D1 and D2 are D.topRows(#F) and
+// D.bottomRows(#F), which are cheap views of a row-major matrix.
+void surface_gradient(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F,
+                      Eigen::SparseMatrix<double, Eigen::RowMajor> &D);
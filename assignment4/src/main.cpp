@@ -1,11 +1,23 @@
 #include <sys/stat.h>
+#include <chrono>
 #include <Eigen/Eigen>
-#include <igl/grad.h>
-#include <igl/local_basis.h>
+#include <igl/adjacency_matrix.h>
+#include <igl/boundary_loop.h>
+#include <igl/cat.h>
+#include <igl/doublearea.h>
+#include <igl/map_vertices_to_circle.h>
+#include <igl/sum.h>
 #include <imgui.h>
 
+#include <mesh_reordering.h>
 #include <viewer_proxy.h>
 
+#include "ArapSolver.h"
+#include "ConstrainedSolver.h"
+#include "DifferentialGeometryCache.h"
+#include "LaplacianAssembler.h"
+#include "SurfaceGradient.h"
+
 /*** insert any necessary libigl headers here ***/
 
 using namespace std;
@@ -23,11 +35,28 @@ Eigen::MatrixXi F;
 
 // UV coordinates, #V x2
 Eigen::MatrixXd UV;
+
+// vertex and face order applied after loading, see mesh_reordering.h
+MeshOrdering meshOrdering = MESH_ORDER_MORTON;
+
+// maps the loaded vertices and faces to their order in the file
+MeshPermutation meshPermutation;
 const char *constraints[] = {"fixed boundary", "2 verts", "DOF"};
 enum { UNIT_DISK_BOUNDARY, TWO_VERTICES_POSITIONS, NECESSARY_DOF };
 int selected_constraint = 0;
 float TextureResolution = 10;
 
+// ARAP solver, factored for the mesh and the constraint type arapConstraint
+ArapSolver arap;
+int arapConstraint = -1;
+
+// number of ARAP local/global iterations per key press
+int arapIterations = 10;
+
+// sparse solver backend of all methods
+int solverBackend = SOLVER_AUTO;
+const char *solverBackends[] = {"auto", "LDLT", "LU", "KKT (LU)"};
+
 void Redraw(ViewerProxy& viewer) {
   // Update the mesh in the viewer.
   ViewerProxy::Data mesh_data = viewer.data(0);
@@ -44,22 +73,10 @@ void Redraw(ViewerProxy& viewer) {
   }
 }
 
-static void computeSurfaceGradientMatrix(SparseMatrix<double> &D1,
-                                         SparseMatrix<double> &D2) {
-  MatrixXd F1, F2, F3;
-  SparseMatrix<double> DD, Dx, Dy, Dz;
-
-  igl::local_basis(V, F, F1, F2, F3);
-  igl::grad(V, F, DD);
-
-  Dx = DD.topLeftCorner(F.rows(), V.rows());
-  Dy = DD.block(F.rows(), 0, F.rows(), V.rows());
-  Dz = DD.bottomRightCorner(F.rows(), V.rows());
-
-  D1 = F1.col(0).asDiagonal() * Dx + F1.col(1).asDiagonal() * Dy +
-       F1.col(2).asDiagonal() * Dz;
-  D2 = F2.col(0).asDiagonal() * Dx + F2.col(1).asDiagonal() * Dy +
-       F2.col(2).asDiagonal() * Dz;
+// Stacked surface gradient [D1; D2] in the local basis of every face, see
+// SurfaceGradient.h.
+static void computeSurfaceGradientMatrix(SparseMatrix<double, RowMajor> &D) {
+  surface_gradient(V, F, D);
 }
 static inline void SSVD2x2(const Eigen::Matrix2d &J, Eigen::Matrix2d &U,
                            Eigen::Matrix2d &S, Eigen::Matrix2d &V) {
@@ -94,14 +111,76 @@ static inline void SSVD2x2(const Eigen::Matrix2d &J, Eigen::Matrix2d &U,
   V(3) = c;
 }
 
-void ConvertConstraintsToMatrixForm(const VectorXi &indices,
-                                    const MatrixXd &positions,
-                                    Eigen::SparseMatrix<double> &C,
-                                    VectorXd &d) {
-  // Convert the list of fixed indices and their fixed positions to a linear
-  // system.
-  // Hint: The matrix C should contain only one non-zero element per row
-  // and d should contain the positions in the correct order.
+// Two vertices far apart: the vertex farthest from vertex 0, and the vertex
+// farthest from that one.
+static void twoDistantVertices(VectorXi &indices, MatrixXd &positions) {
+  int a, b;
+  (V.rowwise() - V.row(0)).rowwise().squaredNorm().maxCoeff(&a);
+  (V.rowwise() - V.row(a)).rowwise().squaredNorm().maxCoeff(&b);
+  indices.resize(2);
+  indices << a, b;
+  // Keep their distance, so that the parameterization has the scale of the
+  // mesh.
+  positions.setZero(2, 2);
+  positions(1, 0) = (V.row(a) - V.row(b)).norm();
+}
+
+// Uniform Laplacian: adjacency matrix minus the vertex degrees on the
+// diagonal.
+static void uniformLaplacian(SparseMatrix<double> &L) {
+  SparseMatrix<double> A;
+  igl::adjacency_matrix(F, A);
+  VectorXd degrees;
+  igl::sum(A, 1, degrees);
+  std::vector<Triplet<double>> triplets;
+  for (int j = 0; j < A.outerSize(); ++j)
+    for (SparseMatrix<double>::InnerIterator it(A, j); it; ++it)
+      triplets.emplace_back(it.row(), j, it.value());
+  for (int i = 0; i < degrees.size(); ++i)
+    triplets.emplace_back(i, i, -degrees(i));
+  L.resize(A.rows(), A.cols());
+  L.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+// Local/global ARAP iterations starting from UV, see ArapSolver.h. The system
+// is factored once per mesh and constraint type.
+static void arapParameterization(const VectorXi &fixed_UV_indices,
+                                 const MatrixXd &fixed_UV_positions) {
+  using Clock = chrono::steady_clock;
+  auto t0 = Clock::now();
+  if (!arap.valid() || arapConstraint != selected_constraint) {
+    SparseMatrix<double, RowMajor> D;
+    computeSurfaceGradientMatrix(D);
+    VectorXd areas;
+    igl::doublearea(V, F, areas);
+    areas /= 2;
+    if (!arap.precompute(D, areas, fixed_UV_indices,
+                         (SolverBackend)solverBackend))
+      return;
+    arapConstraint = selected_constraint;
+  }
+  auto t1 = Clock::now();
+
+  MatrixXd J, R;
+  Clock::duration local(0);
+  for (int iteration = 0; iteration < arapIterations; ++iteration) {
+    // Local step: closest rotation to the Jacobian of every face.
+    auto start = Clock::now();
+    arap.jacobians(UV, J);
+    ArapSolver::local_step(J, R);
+    local += Clock::now() - start;
+    // Global step: back-substitution only.
+    arap.global_step(R, fixed_UV_positions, UV);
+  }
+  auto t2 = Clock::now();
+  const int iterations = max(arapIterations, 1);
+  cout << "ARAP: setup "
+       << chrono::duration<double, milli>(t1 - t0).count() << " ms, "
+       << chrono::duration<double, milli>(t2 - t1).count() / iterations
+       << " ms per iteration, of which "
+       << chrono::duration<double, milli>(local).count() / iterations
+       << " ms local step" << endl;
+  cout << "ARAP global step: " << arap.stats() << endl;
 }
 
 void computeParameterization(int type) {
@@ -109,64 +188,128 @@ void computeParameterization(int type) {
   MatrixXd fixed_UV_positions;
 
   SparseMatrix<double> A;
-  VectorXd b;
-  Eigen::SparseMatrix<double> C;
-  VectorXd d;
+  MatrixXd b;
+  // ARAP starts from the current parameterization, or from LSCM with the
+  // same constraints.
+  if (type == '4' && UV.rows() != V.rows())
+    computeParameterization('3');
+
   // Find the indices of the boundary vertices of the mesh and put them in
   // fixed_UV_indices
   switch (selected_constraint) {
   case UNIT_DISK_BOUNDARY:
     // The boundary vertices should be fixed to positions on the unit disc. Find
     // these position and save them in the #V x 2 matrix fixed_UV_position.
+    igl::boundary_loop(F, fixed_UV_indices);
+    igl::map_vertices_to_circle(V, fixed_UV_indices, fixed_UV_positions);
     break;
   case TWO_VERTICES_POSITIONS:
     // Fix two UV vertices. This should be done in an intelligent way.
     // Hint: The two fixed vertices should be the two most distant one on the
     // mesh.
+    twoDistantVertices(fixed_UV_indices, fixed_UV_positions);
     break;
   case NECESSARY_DOF:
     // Add constraints for fixing only the necessary degrees of freedom for the
     // parameterization, avoiding an unnecessarily over-constrained system.
+    // LSCM is invariant to translation, rotation and scale and needs two
+    // fixed vertices, ARAP only to translation and rotation and needs one,
+    // kept where it is.
+    twoDistantVertices(fixed_UV_indices, fixed_UV_positions);
+    if (type == '4') {
+      fixed_UV_indices.conservativeResize(1);
+      fixed_UV_positions = UV.row(fixed_UV_indices(0));
+    }
     break;
   }
 
-  ConvertConstraintsToMatrixForm(fixed_UV_indices, fixed_UV_positions, C, d);
+  if (type == '4') {
+    // ARAP has its own prefactored solver.
+    arapParameterization(fixed_UV_indices, fixed_UV_positions);
+    return;
+  }
 
   // Find the linear system for the parameterization (1- Tutte, 2- Harmonic, 3-
-  // LSCM, 4- ARAP) and put it in the matrix A. The dimensions of A should be
-  // 2#V x 2#V.
+  // LSCM, 4- ARAP) and put it in the matrix A. Tutte and harmonic solve for u
+  // and v with the same #V x #V matrix, LSCM couples them in a 2#V x 2#V
+  // matrix. The matrices are the positive semidefinite Hessians of the
+  // energies, so the negated Laplacians.
   if (type == '1') {
     // Add your code for computing uniform Laplacian for Tutte parameterization
     // Hint: use the adjacency matrix of the mesh
+    uniformLaplacian(A);
+    A = -A;
   }
 
   if (type == '2') {
     // Add your code for computing cotangent Laplacian for Harmonic
     // parameterization Use can use a function "cotmatrix" from libIGL, but
     // ~~~~***READ THE DOCUMENTATION***~~~~
+    // Assembled straight into compressed storage by the assembler shared
+    // with assignment3, with the same sign convention as igl::cotmatrix.
+    DifferentialGeometryCache geometry;
+    LaplacianAssembler laplacian;
+    geometry.set_mesh(V, F);
+    laplacian.set_topology(geometry);
+    laplacian.assemble(geometry);
+    A = -laplacian.L;
   }
 
   if (type == '3') {
     // Add your code for computing the system for LSCM parameterization
     // Note that the libIGL implementation is different than what taught in the
     // tutorial! Do not rely on it!!
+    // Conformal energy sum_f A_f ((D1 u - D2 v)^2 + (D2 u + D1 v)^2). Its
+    // matrix is [K S; S^T K] with K = D1^T A D1 + D2^T A D2 and
+    // S = D2^T A D1 - D1^T A D2.
+    SparseMatrix<double, RowMajor> D;
+    computeSurfaceGradientMatrix(D);
+    VectorXd areas, weights(2 * F.rows());
+    igl::doublearea(V, F, areas);
+    weights << areas, areas;
+    const SparseMatrix<double> K = D.transpose() * weights.asDiagonal() * D;
+    const SparseMatrix<double> M = D.bottomRows(F.rows()).transpose() *
+                                   areas.asDiagonal() * D.topRows(F.rows());
+    const SparseMatrix<double> S = M - SparseMatrix<double>(M.transpose());
+    SparseMatrix<double> top, bottom;
+    igl::cat(2, K, S, top);
+    igl::cat(2, SparseMatrix<double>(S.transpose()), K, bottom);
+    igl::cat(1, top, bottom, A);
   }
 
-  if (type == '4') {
-    // Add your code for computing ARAP system and right-hand side
-    // Implement a function that computes the local step first
-    // Then construct the matrix with the given rotation matrices
+  // Solve the linear system with the constrained unknowns eliminated, or as
+  // the KKT system [A C^T; C 0], with one row of C per fixed unknown, if that
+  // backend is selected.
+  const int n = V.rows(), k = fixed_UV_indices.size();
+  VectorXi fixed;
+  MatrixXd values;
+  if (type == '3') {
+    fixed.resize(2 * k);
+    fixed << fixed_UV_indices, fixed_UV_indices.array() + n;
+    values.resize(2 * k, 1);
+    values << fixed_UV_positions.col(0), fixed_UV_positions.col(1);
+  } else {
+    fixed = fixed_UV_indices;
+    values = fixed_UV_positions;
   }
-
-  // Solve the linear system.
-  // Construct the system as discussed in class and the assignment sheet
-  // Use igl::cat to concatenate matrices
-  // Use Eigen::SparseLU to solve the system. Refer to tutorial 4 for more
-  // details.
+  b.setZero(A.rows(), values.cols());
+  ConstrainedSolver solver;
+  MatrixXd x;
+  if (!solver.factor(A, fixed, true, (SolverBackend)solverBackend) ||
+      !solver.solve(b, values, x)) {
+    cerr << "Parameterization: solve failed" << endl;
+    return;
+  }
+  cout << "Parameterization " << (char)type << ": " << solver.stats() << endl;
 
   // Copy the solution to UV.
-  // UV.col(0) =
-  // UV.col(1) =
+  UV.resize(n, 2);
+  if (type == '3') {
+    UV.col(0) = x.col(0).head(n);
+    UV.col(1) = x.col(0).tail(n);
+  } else {
+    UV = x;
+  }
 }
 
 bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers) {
@@ -190,6 +333,9 @@ bool callback_key_down(Viewer &viewer, unsigned char key, int modifiers) {
 
 bool load_mesh(Viewer& viewer, string filename) {
   viewer.load_mesh(filename, V, F);
+  reorder_mesh(V, F, meshOrdering, meshPermutation);
+  UV.resize(0, 2);
+  arap.reset();
   viewer.core().align_camera_center(V);
 
   return true;
@@ -246,6 +392,11 @@ int main(int argc, char *argv[]) {
         Redraw(viewer);
       }
 
+      ImGui::InputInt("ARAP iterations", &arapIterations, 0, 0);
+      if (ImGui::Combo("Solver", &solverBackend, solverBackends,
+                       IM_ARRAYSIZE(solverBackends)))
+        arap.reset();
+
       // TODO: Add more parameters to tweak here...
     }
   };
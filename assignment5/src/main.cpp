@@ -8,6 +8,8 @@
 #include <igl/slice_into.h>
 #include <igl/rotate_by_quat.h>
 
+#include <mesh_reordering.h>
+
 #include "Lasso.h"
 #include "Colors.h"
 
@@ -26,6 +28,10 @@ Viewer viewer;
 Eigen::MatrixXd V(0, 3), V_original(0, 3);
 //face array, #F x3
 Eigen::MatrixXi F(0, 3);
+//vertex and face order applied after loading, see mesh_reordering.h
+MeshOrdering meshOrdering = MESH_ORDER_MORTON;
+//maps the loaded vertices and faces to their order in the file
+MeshPermutation meshPermutation;
 
 Deformation solution;
 
@@ -138,6 +144,7 @@ void get_new_handle_locations() {
 
 bool load_mesh(string filename) {
     igl::read_triangle_mesh(filename, V, F);
+    reorder_mesh(V, F, meshOrdering, meshPermutation);
     viewer.data().clear();
     viewer.data().set_mesh(V, F);
 
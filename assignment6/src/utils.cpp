@@ -135,10 +135,16 @@ static bool file_exists(const std::string &file_path) {
 }
 
 MeshData load_obj(const std::string &filename,
-                  const std::string &texture_filename) {
+                  const std::string &texture_filename, MeshOrdering ordering) {
   MeshData mesh_data;
   igl::readOBJ(filename, mesh_data.V, mesh_data.UV, mesh_data.VN, mesh_data.F,
                mesh_data.F_UV, mesh_data.FN);
+  reorder_mesh(mesh_data.V, mesh_data.F, ordering, mesh_data.permutation);
+  // Texture and normal indices follow the faces.
+  if (mesh_data.F_UV.rows() == mesh_data.F.rows())
+    gather_rows(mesh_data.permutation.faces, mesh_data.F_UV, mesh_data.F_UV);
+  if (mesh_data.FN.rows() == mesh_data.F.rows())
+    gather_rows(mesh_data.permutation.faces, mesh_data.FN, mesh_data.FN);
   if (file_exists(texture_filename)) {
     igl::stb::read_image(texture_filename, mesh_data.texture_R,
                          mesh_data.texture_G, mesh_data.texture_B,
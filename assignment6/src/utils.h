@@ -1,6 +1,7 @@
 #pragma once
 #define PI 3.14159265358979323846
 #include <Eigen/Eigen>
+#include <mesh_reordering.h>
 
 namespace utils {
 
@@ -21,6 +22,8 @@ struct MeshData {
       texture_G, texture_B, texture_A;
   bool has_texture;
   Eigen::MatrixXi F, F_UV, FN;
+  // Maps the vertices and faces to their order in the file.
+  MeshPermutation permutation;
 };
 
 /**
@@ -72,8 +75,13 @@ void load_skeleton(const std::string &filename, Eigen::MatrixXd &bones,
  * @param filename The name of the OBJ file to load.
  * @param texture_filename The name of the texture file to load (optional).
  *                        If not provided, no texture will be loaded.
+ * @param ordering Vertex order applied after loading, see mesh_reordering.h.
+ *                 Per-vertex data read from other files (weights, handles)
+ *                 is in file order and must be brought into the new order
+ *                 with gather_rows(mesh_data.permutation.vertices, ...).
  * @return MeshData
  */
 MeshData load_obj(const std::string &filename,
-                  const std::string &texture_filename = "");
+                  const std::string &texture_filename = "",
+                  MeshOrdering ordering = MESH_ORDER_NONE);
 } // namespace utils
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+#include <Eigen/Core>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Vertex and face reordering for memory locality, applied right after loading
+// a mesh. Files often list vertices in an order unrelated to the surface, so
+// one-ring walks and sparse matrix products over the mesh jump around memory.
+// Renumbering the vertices along a space-filling curve (Morton order) or by
+// reverse Cuthill-McKee (which also shrinks the bandwidth, and with it the
+// fill-in of sparse factorizations) keeps neighbours close in memory, and
+// sorting the faces by their smallest vertex in the new order does the same for
+// per-face loops.
+//
+// The permutation is kept so that data stored in file order (e.g. skinning
+// weights) can be brought into the new order with gather_rows, and results
+// written back in file order with scatter_rows.
+
+enum MeshOrdering { MESH_ORDER_NONE, MESH_ORDER_MORTON, MESH_ORDER_RCM };
+
+// Maps the new order to the file order: new vertex i is file vertex
+// vertices(i), and new face f is file face faces(f).
+struct MeshPermutation {
+  Eigen::VectorXi vertices, faces;
+};
+
+namespace mesh_reordering {
+
+// Spreads the low 21 bits of x to every third bit.
+inline uint64_t spread_bits(uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffffull;
+  x = (x | x << 16) & 0x1f0000ff0000ffull;
+  x = (x | x << 8) & 0x100f00f00f00f00full;
+  x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+  x = (x | x << 2) & 0x1249249249249249ull;
+  return x;
+}
+
+// Vertices sorted by the Morton code of their position in the bounding box.
+inline void morton_order(const Eigen::MatrixXd &V, Eigen::VectorXi &order) {
+  const Eigen::RowVector3d lo = V.colwise().minCoeff();
+  const double extent = (V.colwise().maxCoeff() - lo).maxCoeff();
+  const double scale = extent > 0 ? ((1 << 21) - 1) / extent : 0;
+  std::vector<std::pair<uint64_t, int>> keys(V.rows());
+  for (int i = 0; i < V.rows(); ++i) {
+    uint64_t code = 0;
+    for (int d = 0; d < 3; ++d)
+      code |= spread_bits((uint64_t)((V(i, d) - lo[d]) * scale)) << d;
+    keys[i] = std::make_pair(code, i);
+  }
+  std::sort(keys.begin(), keys.end());
+  order.resize(V.rows());
+  for (int i = 0; i < V.rows(); ++i)
+    order(i) = keys[i].second;
+}
+
+// Reverse Cuthill-McKee order of the vertex graph of F, each connected
+// component started from a pseudo-peripheral vertex (George and Liu 1979).
+inline void rcm_order(int n, const Eigen::MatrixXi &F, Eigen::VectorXi &order) {
+  // Adjacency in CSR form, without duplicates.
+  std::vector<int> start(n + 1, 0), adjacency;
+  for (int f = 0; f < F.rows(); ++f)
+    for (int c = 0; c < F.cols(); ++c)
+      start[F(f, c) + 1] += 2;
+  for (int i = 0; i < n; ++i)
+    start[i + 1] += start[i];
+  adjacency.resize(start[n]);
+  std::vector<int> fill(start.begin(), start.end() - 1);
+  for (int f = 0; f < F.rows(); ++f)
+    for (int c = 0; c < F.cols(); ++c) {
+      const int a = F(f, c), b = F(f, (c + 1) % F.cols());
+      adjacency[fill[a]++] = b;
+      adjacency[fill[b]++] = a;
+    }
+  std::vector<int> degree(n);
+  for (int i = 0; i < n; ++i) {
+    auto begin = adjacency.begin() + start[i];
+    auto end = adjacency.begin() + start[i + 1];
+    std::sort(begin, end);
+    degree[i] = std::unique(begin, end) - begin;
+  }
+
+  // Breadth-first search from root over the vertices not visited before,
+  // taking the neighbours of each vertex by increasing degree. Leaves the
+  // visited vertices marked and in queue, sets last to the start of the last
+  // level in queue and returns the number of levels.
+  std::vector<char> visited(n, false);
+  std::vector<int> queue, neighbours;
+  auto bfs = [&](int root, size_t &last) {
+    queue.assign(1, root);
+    visited[root] = true;
+    int levels = 0;
+    for (size_t head = 0; head < queue.size(); ++levels) {
+      last = head;
+      for (const size_t level_end = queue.size(); head < level_end; ++head) {
+        const int v = queue[head];
+        neighbours.clear();
+        for (int k = start[v]; k < start[v] + degree[v]; ++k)
+          if (!visited[adjacency[k]]) {
+            visited[adjacency[k]] = true;
+            neighbours.push_back(adjacency[k]);
+          }
+        std::sort(neighbours.begin(), neighbours.end(),
+                  [&](int a, int b) { return degree[a] < degree[b]; });
+        queue.insert(queue.end(), neighbours.begin(), neighbours.end());
+      }
+    }
+    return levels;
+  };
+
+  std::vector<int> by_degree(n);
+  for (int i = 0; i < n; ++i)
+    by_degree[i] = i;
+  std::stable_sort(by_degree.begin(), by_degree.end(),
+                   [&](int a, int b) { return degree[a] < degree[b]; });
+  std::vector<int> result;
+  result.reserve(n);
+  size_t last;
+  for (int seed : by_degree) {
+    if (visited[seed])
+      continue;
+    // Pseudo-peripheral root: move to a vertex of least degree in the last
+    // level as long as that deepens the search.
+    int root = seed, depth = 0;
+    for (int pass = 0, candidate = seed; pass < 8; ++pass) {
+      const int levels = bfs(candidate, last);
+      for (int v : queue)
+        visited[v] = false;
+      if (levels <= depth)
+        break;
+      root = candidate;
+      depth = levels;
+      candidate = queue[last];
+      for (size_t k = last + 1; k < queue.size(); ++k)
+        if (degree[queue[k]] < degree[candidate])
+          candidate = queue[k];
+    }
+    bfs(root, last);
+    result.insert(result.end(), queue.begin(), queue.end());
+  }
+  order.resize(n);
+  for (int i = 0; i < n; ++i)
+    order(i) = result[n - 1 - i];
+}
+
+} // namespace mesh_reordering
+
+// Y.row(i) = X.row(order(i)), e.g. to bring per-vertex data stored in file
+// order into the new order with order = P.vertices. Y may be X.
+template <typename DerivedX, typename DerivedY>
+void gather_rows(const Eigen::VectorXi &order,
+                 const Eigen::MatrixBase<DerivedX> &X,
+                 Eigen::PlainObjectBase<DerivedY> &Y) {
+  typename DerivedY::PlainObject result(order.size(), X.cols());
+  for (int i = 0; i < order.size(); ++i)
+    result.row(i) = X.row(order(i));
+  Y = result;
+}
+
+// Y.row(order(i)) = X.row(i), e.g. to write per-vertex results back in file
+// order with order = P.vertices. Y may be X.
+template <typename DerivedX, typename DerivedY>
+void scatter_rows(const Eigen::VectorXi &order,
+                  const Eigen::MatrixBase<DerivedX> &X,
+                  Eigen::PlainObjectBase<DerivedY> &Y) {
+  typename DerivedY::PlainObject result(order.size(), X.cols());
+  for (int i = 0; i < order.size(); ++i)
+    result.row(order(i)) = X.row(i);
+  Y = result;
+}
+
+// Reorder the vertices of (V, F) with the given ordering, remap F, and sort
+// the faces by their smallest new vertex index.
+//
+// Inputs:
+//   V  #V x3 vertex positions
+//   F  #F x3 faces
+//   ordering  vertex ordering, MESH_ORDER_NONE leaves the mesh as is
+// Outputs:
+//   V, F  the reordered mesh
+//   P  permutation from the new to the file order
+inline void reorder_mesh(Eigen::MatrixXd &V, Eigen::MatrixXi &F,
+                         MeshOrdering ordering, MeshPermutation &P) {
+  const int n = V.rows(), m = F.rows();
+  if (ordering == MESH_ORDER_NONE) {
+    P.vertices = Eigen::VectorXi::LinSpaced(n, 0, n - 1);
+    P.faces = Eigen::VectorXi::LinSpaced(m, 0, m - 1);
+    return;
+  }
+  if (ordering == MESH_ORDER_MORTON)
+    mesh_reordering::morton_order(V, P.vertices);
+  else
+    mesh_reordering::rcm_order(n, F, P.vertices);
+
+  Eigen::VectorXi new_index(n);
+  for (int i = 0; i < n; ++i)
+    new_index(P.vertices(i)) = i;
+  for (int f = 0; f < m; ++f)
+    for (int c = 0; c < F.cols(); ++c)
+      F(f, c) = new_index(F(f, c));
+  gather_rows(P.vertices, V, V);
+
+  // Stable counting sort of the faces by their smallest vertex.
+  P.faces.resize(m);
+  std::vector<int> start(n + 1, 0);
+  for (int f = 0; f < m; ++f)
+    ++start[F.row(f).minCoeff() + 1];
+  for (int i = 0; i < n; ++i)
+    start[i + 1] += start[i];
+  for (int f = 0; f < m; ++f)
+    P.faces(start[F.row(f).minCoeff()]++) = f;
+  gather_rows(P.faces, F, F);
+}